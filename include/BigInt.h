@@ -4,41 +4,178 @@
 #include <string.h>
 #include <array>
 #include <vector>
+#include <memory>
 #include "RandomGenerator.h"
 
 static_assert(sizeof(unsigned int) == 4, "Support only 32-bit of integer");
 
+///
+/// Amount of bits in one block (limb) of BigInt.
+/// 64-bit blocks are used where compiler has 128-bit integer,
+/// otherwise 32-bit blocks. 30-bit blocks are kept as reference
+/// implementation, select them by -DBIGINT_BLOCK_BITS=30.
+///
+#ifndef BIGINT_BLOCK_BITS
+#ifdef __SIZEOF_INT128__
+#define BIGINT_BLOCK_BITS		64
+#else
+#define BIGINT_BLOCK_BITS		32
+#endif
+#endif
 
-typedef  unsigned int block;
+#if BIGINT_BLOCK_BITS == 64
+typedef uint64_t block;
+__extension__ typedef unsigned __int128 dblock;
+#elif BIGINT_BLOCK_BITS == 32 || BIGINT_BLOCK_BITS == 30
+typedef uint32_t block;
+typedef uint64_t dblock;
+#else
+#error "Supported sizes of BigInt block are 30, 32 and 64 bits"
+#endif
 
 
-class BigInt {
+struct MontKernel52;
+class ThreadPool;
+template <unsigned int Bits>
+class BigIntWorkspace;
+template <unsigned int Bits>
+class BigIntModContext;
+template <unsigned int Bits>
+class BigIntExponent;
+template <unsigned int Bits>
+class BigIntFixedBaseExp;
+template <unsigned int Bits>
+class BigIntBatch;
+
+///
+/// Big integer of fixed length Bits with inline storage.
+/// Supported lengths are 512, 1024, 2048, 3072, 4096 bits and
+/// their doubles 6144 and 8192 bits (used for products).
+///
+template <unsigned int Bits>
+class FixedBigInt {
+	template <unsigned int> friend class FixedBigInt;
+	template <unsigned int> friend class BigIntModContext;
+	template <unsigned int> friend class BigIntBatch;
 public:
-	BigInt();
-	BigInt(const char *strHexNumber);
-	BigInt(std::string &strHexNumber);
-	BigInt(BigInt&& number);
-	virtual ~BigInt();
-	BigInt& operator=(BigInt&& number) = delete;
 	///
-	/// only for tests
+	/// Number with twice more bits for products and modular reduction.
+	///
+	typedef FixedBigInt<2 * Bits> Double;
+	typedef BigIntWorkspace<Bits> Workspace;
+	typedef BigIntModContext<Bits> ModContext;
+	typedef BigIntExponent<Bits> Exponent;
+	typedef BigIntFixedBaseExp<Bits> FixedBaseExp;
+	typedef BigIntBatch<Bits> Batch;
+
+	FixedBigInt();
+	FixedBigInt(const char *strHexNumber);
+	FixedBigInt(std::string &strHexNumber);
+	///
+	/// Copy takes only value of number. Move also takes context of
+	/// modular reduction, so moved module is ready for `mod` and
+	/// Montgomery multiplication and the source has no context.
+	/// Assignment drops context of the destination.
+	///
+	FixedBigInt(const FixedBigInt &number);
+	FixedBigInt(FixedBigInt&& number);
+	///
+	/// Conversion between lengths, value should fit to Bits.
+	///
+	template <unsigned int B>
+	explicit FixedBigInt(const FixedBigInt<B> &number);
+	FixedBigInt& operator=(const FixedBigInt &number);
+	FixedBigInt& operator=(FixedBigInt&& number);
+	///
+	/// Addition and subtraction are modulo 2^Bits.
+	///
+	FixedBigInt operator+(const FixedBigInt &y) const;
+	FixedBigInt operator-(const FixedBigInt &y) const;
+	///
+	/// Full product, see `mul`.
+	///
+	Double operator*(const FixedBigInt &y) const;
 	///
-	static BigInt* getDoubleNumber();
+	/// Remainder of division by m. Uses context of m if it is
+	/// initialized and this is less than m^2, division otherwise.
+	///
+	template <unsigned int B>
+	FixedBigInt<B> operator%(const FixedBigInt<B> &m) const;
 	unsigned int getLength();
-	bool add(const BigInt &number);
-	void sub(const BigInt &number);
+	template <unsigned int B>
+	bool add(const FixedBigInt<B> &number);
+	template <unsigned int B>
+	void sub(const FixedBigInt<B> &number);
 	void mulByBit(int bitValue);
-	bool div(const BigInt &y, BigInt &q, BigInt &r) const;
-	void mulMont(const BigInt &y, const BigInt &m, BigInt &ret) const;
-	void mod(const BigInt &m);
-	void exp(const BigInt &e, const BigInt &m, BigInt &ret) const;
+	///
+	/// Long division: this = q * y + r, r < y.
+	/// q and r are overwritten. Returns false when y is zero.
+	///
+	bool div(const FixedBigInt &y, FixedBigInt &q, FixedBigInt &r) const;
+	///
+	/// Division by one block d, d should not exceed maximum value of
+	/// block: q = this / d, returns this mod d. q could be this number.
+	///
+	block divmodWord(block d, FixedBigInt &q) const;
+	block modWord(block d) const;
+	void mulMont(const FixedBigInt &y, const FixedBigInt &m, FixedBigInt &ret) const;
+	///
+	/// Word-level (CIOS) Montgomery multiplication.
+	/// Result is the same as for `mulMont`: ret = this * y mod m.
+	/// Needs `initModularReduction` for module m or its context.
+	///
+	void mulMontCIOS(const FixedBigInt &y, const FixedBigInt &m, FixedBigInt &ret) const;
+	void mulMontCIOS(const FixedBigInt &y, const ModContext &ctx, FixedBigInt &ret) const;
+	///
+	/// Montgomery form x' = x * R mod m, where R is defined by context.
+	/// `montMul` and `montSqr` take and return numbers in Montgomery
+	/// form, so chains of operations need only one conversion to the
+	/// form and one conversion back. Numbers should be less than m.
+	///
+	void toMont(const ModContext &ctx, FixedBigInt &ret) const;
+	void fromMont(const ModContext &ctx, FixedBigInt &ret) const;
+	void montMul(const FixedBigInt &y, const ModContext &ctx, FixedBigInt &ret) const;
+	void montSqr(const ModContext &ctx, FixedBigInt &ret) const;
+	///
+	/// Squaring by module: ret = this^2 mod m, this should be less than m.
+	///
+	void sqrMod(const ModContext &ctx, FixedBigInt &ret) const;
+	///
+	/// Montgomery reduction: ret = t * R^(-1) mod m, t < m * R.
+	///
+	static void montRedc(const Double &t, const ModContext &ctx, FixedBigInt &ret);
+	///
+	/// Module m should be not shorter than half of this number.
+	///
+	template <unsigned int B>
+	void mod(const FixedBigInt<B> &m);
+	template <unsigned int B>
+	void mod(const FixedBigInt<B> &m, BigIntWorkspace<B> &ws);
+	template <unsigned int B>
+	void mod(const BigIntModContext<B> &ctx);
+	template <unsigned int B>
+	void mod(const BigIntModContext<B> &ctx, BigIntWorkspace<B> &ws);
+	void exp(const FixedBigInt &e, const FixedBigInt &m, FixedBigInt &ret) const;
+	void exp(const FixedBigInt &e, const FixedBigInt &m, FixedBigInt &ret,
+		 Workspace &ws) const;
+	void exp(const FixedBigInt &e, const ModContext &ctx, FixedBigInt &ret) const;
+	void exp(const FixedBigInt &e, const ModContext &ctx, FixedBigInt &ret,
+		 Workspace &ws) const;
+	///
+	/// Exponentiation by recoded exponent, recoding of fixed exponent
+	/// could be done once and reused.
+	///
+	void exp(const Exponent &e, const ModContext &ctx, FixedBigInt &ret) const;
+	void exp(const Exponent &e, const ModContext &ctx, FixedBigInt &ret,
+		 Workspace &ws) const;
 
 	///
 	///  1 if this > number
 	/// -1 if this < number
 	///  0 if this == number
 	///
-	int cmp(const BigInt &number) const;
+	template <unsigned int B>
+	int cmp(const FixedBigInt<B> &number) const;
 	int cmp(block number) const;
 	int fromString(const char *hexString);
 	int fromString(const std::string &hexString);
@@ -49,67 +186,306 @@ public:
 	void shiftRightBlock(unsigned int countBits);
 	void shiftRightBit();
 	void shiftRight(unsigned int countBits);
-	void setBit(unsigned int position, unsigned int value) const;
+	void setBit(unsigned int position, unsigned int value);
 	int getBit(unsigned int position) const;
 	int clearBit(unsigned int position);
-	BigInt* copy() const;
-	void copyContent(const BigInt &number);
-	int isEqual(const BigInt &number);
+	FixedBigInt* copy() const;
+	template <unsigned int B>
+	void copyContent(const FixedBigInt<B> &number);
+	template <unsigned int B>
+	int isEqual(const FixedBigInt<B> &number) const;
 	void setMax();
 	void setZero();
 	void setNumber(unsigned int number);
 	bool isZero() const;
 	int getPosMostSignificatnBit() const;
 	///
-	/// Create pre-compilation table for modular reduction.
-	/// Should be called for module m.
+	/// Create context of modular reduction and attach it to this
+	/// number. Should be called for module m.
 	/// Need for methods modular reduction `mod` and Montgomery
-	/// multiplication `mulMont`.
+	/// multiplication `mulMont` which take module as number.
+	/// Shared users should create `ModContext` instead.
 	///
 	void initModularReduction();
 	///
-	/// Destroy pre-compilation table for modular reduction.
-	/// Should be called for module m.
-	/// Need for methods modular reduction `mod` and Montgomery
-	/// multiplication `mulMont`.
+	/// The same as `initModularReduction`, but context is placed to
+	/// workspace. Workspace should live until
+	/// `shutDownModularReduction` is called.
+	///
+	void initModularReduction(Workspace &ws);
+	///
+	/// Detach context of modular reduction from this number.
 	///
 	void shutDownModularReduction();
-	void generateRand(RandomGenerator &gen, int size=1024);
+	void generateRand(RandomGenerator &gen, int size=Bits);
 	void generatePrime(RandomGenerator &gen);
-	void gcd(const BigInt &a, BigInt &res) const;
+	void generatePrime(RandomGenerator &gen, Workspace &ws);
+	void gcd(const FixedBigInt &a, FixedBigInt &res) const;
+	///
+	/// Modular inverse by binary extended Euclid: ret = this^(-1) mod m.
+	/// Module should be odd. Returns false if gcd(this, m) is not one.
+	///
+	bool modInverse(const FixedBigInt &m, FixedBigInt &ret) const;
+	///
+	/// Jacobi symbol (this / n) by binary algorithm, n should be odd.
+	/// For prime n it is Legendre symbol: 1 for quadratic residue,
+	/// -1 for non-residue and 0 if n divides this number.
+	///
+	int jacobi(const FixedBigInt &n) const;
 	bool isEven() const;
 	void generateBlumPrime(RandomGenerator &gen);
-	void generateBlumPrime(RandomGenerator &gen, BigInt &r, BigInt &s);
+	void generateBlumPrime(RandomGenerator &gen, FixedBigInt &r, FixedBigInt &s);
+	void generateBlumPrime(RandomGenerator &gen, FixedBigInt &r, FixedBigInt &s,
+			       Workspace &ws);
+	///
+	/// Parallel search: r and s are searched at once and candidates of
+	/// every window are tested by all threads of pool. The first prime
+	/// of sequence of candidates is taken and bases of Miller-Rabin test
+	/// depend only on candidate, so result is defined by generator and
+	/// does not depend on amount of threads.
+	///
+	void generateBlumPrime(RandomGenerator &gen, FixedBigInt &r, FixedBigInt &s,
+			       ThreadPool &pool);
 	std::vector<uint8_t> getByteArray() const;
 	void getByteArray(std::vector<uint8_t> &byteArray) const;
-	void mulHalfNumbers(const BigInt &y, BigInt &res) const;
+	///
+	/// Full multiplication: res = this * y.
+	/// Uses schoolbook or Karatsuba method depending on size of numbers.
+	/// res should be double number or product should fit to it.
+	///
+	template <unsigned int B>
+	void mul(const FixedBigInt &y, FixedBigInt<B> &res) const;
 
 private:
-	block *blocks_;
-	const unsigned int length_;
-	const unsigned int size_;
-	const unsigned int countBistLastBlock_;
-	const block maxValueLastBlock_;
+	static const unsigned int length_ = Bits;
+	static const unsigned int size_ = (Bits + BIGINT_BLOCK_BITS - 1) / BIGINT_BLOCK_BITS;
+	static const unsigned int countBistLastBlock_ = Bits - (size_ - 1) * BIGINT_BLOCK_BITS;
+	static const block maxValueLastBlock_ = countBistLastBlock_ == sizeof(block) * 8 ?
+		~(block)0 : ((block)1 << countBistLastBlock_) - 1;
+
+	std::array<block, size_> blocks_;
 
 	///
-	/// Using only for Montgomery multiplication and modular reduction.
+	/// Context attached by `initModularReduction`. ownContext_ is
+	/// empty when context is placed in workspace.
 	///
-	BigInt **preComputedTable_;
-	int posMostSignBit_;
+	const ModContext *context_;
+	std::shared_ptr<const ModContext> ownContext_;
 
-	BigInt(unsigned int lengthBits);
 	int hexCharToInteger(char digit);
-	void rawArrayToBlocks(std::vector<block> &rawArray);
-	void blocksToRawArray(std::vector<block> &rawArray) const;
+	void rawArrayToBlocks(std::vector<uint32_t> &rawArray);
+	void blocksToRawArray(std::vector<uint32_t> &rawArray) const;
 	char integerToHexChar(int symbol) const;
-	void splitToRWords(std::vector<block> &rWords, int lenBits) const;
 	static block fillBits(unsigned int amountBits);
-	bool testSimpleDivision();
-	bool isDivisor(BigInt &x);
-	bool testMillerRabin_real(int k, RandomGenerator &gen, std::vector<block> &randArray);
-	bool testMillerRabin(int k, RandomGenerator &gen, std::vector<block> &randArray);
-	void generatePartBlumPrime(RandomGenerator &gen, std::vector<block> &randArray,
-				   int partSize);
-	void generateRand(RandomGenerator& gen, std::vector<block> &randArray, int size);
+	template <unsigned int B>
+	void modWithTemp(const BigIntModContext<B> &ctx, typename FixedBigInt<B>::Double &r);
+	static void montRedcCIOS(const ModContext &ctx, const block *x, const block *y,
+				 block *t);
+	static void montRedcBlocks(const ModContext &ctx, block *r, FixedBigInt &ret);
+	void expMont(const Exponent &e, const ModContext &ctx, FixedBigInt &ret,
+		     Workspace &ws) const;
+	void expKernel(const Exponent &e, const ModContext &ctx, FixedBigInt &ret,
+		       Workspace &ws) const;
+	void toDigits(uint64_t *digits, unsigned int count, unsigned int digitBits) const;
+	void fromDigits(const uint64_t *digits, unsigned int count, unsigned int digitBits);
+	void smallPrimesResidues(std::vector<block> &residues) const;
+	void randomStart(RandomGenerator &gen, std::vector<uint32_t> &randArray, int words,
+			 unsigned int step);
+	void searchPrime(RandomGenerator &gen, Workspace &ws, int words, unsigned int step);
+	bool isDivisor(FixedBigInt &x, Workspace &ws);
+	bool testMillerRabin_real(int k, RandomGenerator &gen, Workspace &ws);
+	bool testMillerRabin(int k, RandomGenerator &gen, Workspace &ws);
+	void generatePartBlumPrime(RandomGenerator &gen, Workspace &ws, int partSize);
+	void generateRand(RandomGenerator& gen, std::vector<uint32_t> &randArray, int size);
+};
+
+///
+/// Immutable context of modular reduction for module m: table of
+/// 2^i mod m for `mod` and parameters of Montgomery multiplication.
+/// Context is built once per module and could be shared by any
+/// amount of threads without locks.
+///
+template <unsigned int Bits>
+class BigIntModContext {
+	template <unsigned int> friend class FixedBigInt;
+	friend class BigIntWorkspace<Bits>;
+public:
+	explicit BigIntModContext(const FixedBigInt<Bits> &m);
+	BigIntModContext(const BigIntModContext&) = delete;
+	void operator=(const BigIntModContext&) = delete;
+	static std::shared_ptr<const BigIntModContext> create(const FixedBigInt<Bits> &m);
+	const FixedBigInt<Bits>& getModule() const;
+private:
+	BigIntModContext();
+	void init(const FixedBigInt<Bits> &m);
+
+	FixedBigInt<Bits> module_;
+	///
+	/// table_[i] = 2^(posMostSignBit_ + i) mod m for reduction of
+	/// numbers up to 2 * posMostSignBit_ + 2 bits.
+	///
+	std::vector<typename FixedBigInt<Bits>::Double> table_;
+	int posMostSignBit_;
+	///
+	/// montInv_ is -m^(-1) mod 2^BLOCK_BITS, montSize_ is amount of
+	/// significant blocks of m and montR2_ is R^2 mod m,
+	/// where R = 2^(BLOCK_BITS * montSize_).
+	///
+	block montInv_;
+	unsigned int montSize_;
+	FixedBigInt<Bits> montR2_;
+	///
+	/// Vectorized kernel for exponentiation (NULL if there is no one)
+	/// and module, -m^(-1) mod 2^52, R^2 mod m in its radix 2^52,
+	/// where R = 2^(52 * digits).
+	///
+	const MontKernel52 *kernel_;
+	std::vector<uint64_t> digitsModule_;
+	uint64_t digitsInv_;
+	std::vector<uint64_t> digitsR2_;
+};
+
+///
+/// Exponent recoded for sliding-window exponentiation.
+/// Size of window is chosen by length of exponent and only odd powers
+/// of base are pre-computed.
+///
+template <unsigned int Bits>
+class BigIntExponent {
+	template <unsigned int> friend class FixedBigInt;
+	friend class BigIntBatch<Bits>;
+public:
+	BigIntExponent();
+	explicit BigIntExponent(const FixedBigInt<Bits> &e);
+	void recode(const FixedBigInt<Bits> &e);
+	unsigned int getWindow() const;
+private:
+	///
+	/// Result starts from power of the first step, then for every
+	/// next step it is squared `squares` times and multiplied by
+	/// power `digit` if digit is not zero. Digits are odd.
+	///
+	struct Step {
+		uint16_t squares;
+		uint16_t digit;
+	};
+	std::vector<Step> steps_;
+	unsigned int window_;
+};
+
+///
+/// Exponentiation of fixed base by Lim-Lee comb method.
+/// Exponent of up to teeth * columns bits is split into `teeth` rows
+/// and table keeps products of base^(2^(row * columns)) for every subset
+/// of rows, so exponentiation needs only columns - 1 squarings.
+/// Table has 2^teeth numbers, more teeth means fewer operations.
+/// Context should outlive the object.
+///
+template <unsigned int Bits>
+class BigIntFixedBaseExp {
+public:
+	BigIntFixedBaseExp(const FixedBigInt<Bits> &base, const BigIntModContext<Bits> &ctx,
+			   unsigned int maxExpBits = Bits, unsigned int teeth = 6);
+	void exp(const FixedBigInt<Bits> &e, FixedBigInt<Bits> &ret) const;
+	unsigned int getTableSize() const;
+private:
+	const BigIntModContext<Bits> &context_;
+	FixedBigInt<Bits> base_;
+	unsigned int teeth_;
+	unsigned int columns_;
+	///
+	/// Montgomery forms, table_[i] is product of base^(2^(row * columns_))
+	/// for every row which bit is set in i.
+	///
+	std::vector<FixedBigInt<Bits>> table_;
+};
+
+///
+/// Batch of numbers by common module for lane-parallel arithmetic.
+/// Numbers are kept in radix 2^52 in structure-of-arrays layout by groups
+/// of BATCH52_LANES numbers: digit j of all numbers of group is contiguous,
+/// so vector lanes process different numbers at once. Without AVX-512
+/// IFMA every number is processed by usual arithmetic of blocks.
+/// Context should outlive the batch.
+///
+template <unsigned int Bits>
+class BigIntBatch {
+public:
+	BigIntBatch(const BigIntModContext<Bits> &ctx, unsigned int count);
+	unsigned int size() const;
+	///
+	/// Number is reduced by module when it is set.
+	///
+	void set(unsigned int lane, const FixedBigInt<Bits> &x);
+	void get(unsigned int lane, FixedBigInt<Bits> &x) const;
+	///
+	/// ret = this * y mod m for every lane. Batches should have the same
+	/// context and size, ret could be this or y.
+	///
+	void mulMont(const BigIntBatch &y, BigIntBatch &ret) const;
+	///
+	/// ret = this^e mod m for every lane.
+	///
+	void exp(const FixedBigInt<Bits> &e, BigIntBatch &ret) const;
+	void exp(const BigIntExponent<Bits> &e, BigIntBatch &ret) const;
+private:
+	const BigIntModContext<Bits> &context_;
+	unsigned int count_;
+	unsigned int digits_;
+	uint64_t montInv_;
+	std::vector<uint64_t> module_;
+	///
+	/// R^2 mod m and one in every lane of group, where R = 2^(52 * digits_).
+	///
+	std::vector<uint64_t> montR2_;
+	std::vector<uint64_t> one_;
+	std::vector<uint64_t> lanes_;
 };
 
+///
+/// Reusable temporaries for operations with numbers of length Bits.
+/// Operations which take workspace do not allocate memory after the
+/// first call, so long-lived users (signing, prime search) should keep
+/// one workspace and pass it to every call.
+/// Workspace could be used only by one thread at the same time.
+///
+template <unsigned int Bits>
+class BigIntWorkspace {
+	template <unsigned int> friend class FixedBigInt;
+public:
+	BigIntWorkspace() : rawArray_(Bits / 32) {}
+	BigIntWorkspace(const BigIntWorkspace&) = delete;
+	void operator=(const BigIntWorkspace&) = delete;
+private:
+	///
+	/// Odd powers of base and recoded exponent for exponentiation.
+	///
+	FixedBigInt<Bits> powers_[32];
+	BigIntExponent<Bits> exponent_;
+	std::vector<uint64_t> digits_;
+	///
+	/// Temporaries for division in tests of primality.
+	///
+	FixedBigInt<Bits> temp_[2];
+	///
+	/// State of incremental prime search: start of current window
+	/// and its remainders by small primes.
+	///
+	FixedBigInt<Bits> start_;
+	std::vector<block> residues_;
+	std::vector<uint8_t> sieve_;
+	typename FixedBigInt<Bits>::Double double_;
+	BigIntModContext<Bits> context_;
+	std::vector<uint32_t> rawArray_;
+};
+
+typedef FixedBigInt<512> BigInt512;
+typedef FixedBigInt<1024> BigInt1024;
+typedef FixedBigInt<2048> BigInt2048;
+typedef FixedBigInt<3072> BigInt3072;
+typedef FixedBigInt<4096> BigInt4096;
+
+///
+/// Default length of number.
+///
+typedef BigInt1024 BigInt;
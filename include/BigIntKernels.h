@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+///
+/// Montgomery multiplication of numbers in radix 2^52:
+/// r = a * b * 2^(-52 * digits) mod m.
+/// Numbers are arrays of MONT52_STRIDE(digits) 52-bit digits, digits above
+/// `digits` are zero. a and b should be less than m, m should be odd and
+/// k0 = -m^(-1) mod 2^52. r could be the same array as a or b.
+///
+typedef void (*MontMul52)(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			  const uint64_t *m, uint64_t k0);
+
+#define MONT52_DIGIT_BITS		52
+#define MONT52_DIGIT_MASK		((UINT64_C(1) << MONT52_DIGIT_BITS) - 1)
+#define MONT52_STRIDE(digits)		(((digits) + 7) & ~7u)
+
+struct MontKernel52 {
+	const char *name;
+	unsigned int digits;
+	MontMul52 mul;
+	MontMul52 sqr;
+};
+
+///
+/// Vectorized kernel for module of `bits` length (512-bit and 1024-bit
+/// kernels), selected once by CPUID. Returns NULL when CPU has no
+/// support, kernels are disabled or there is no kernel for the length,
+/// then usual arithmetic of blocks should be used.
+///
+const MontKernel52* getMontKernel52(unsigned int bits);
+///
+/// Portable kernel with the same results, reference for tests.
+///
+const MontKernel52* getScalarMontKernel52(unsigned int bits);
+///
+/// Vectorized kernels are enabled by default. Disabling affects contexts
+/// of modules created after the call and following batch multiplications.
+///
+void setMontKernels52Enabled(bool enabled);
+
+///
+/// Lane-parallel Montgomery multiplication of BATCH52_LANES independent
+/// numbers with common module in radix 2^52:
+/// r = a * b * 2^(-52 * digits) mod m for every lane.
+/// Numbers are in structure-of-arrays layout, digit j of lane l is
+/// at j * BATCH52_LANES + l. Module m is array of `digits` digits,
+/// k0 = -m^(-1) mod 2^52 and scratch is array of BATCH52_SCRATCH(digits).
+/// Lanes of a and b should be less than m, r could be the same array
+/// as a or b. Lanes are processed by AVX-512 IFMA when CPU supports it,
+/// otherwise one by one.
+///
+#define BATCH52_LANES			8
+#define BATCH52_SCRATCH(digits)		((4 * (digits) + 2) * BATCH52_LANES)
+
+void montMulBatch52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+		    const uint64_t *m, uint64_t k0, unsigned int digits,
+		    uint64_t *scratch);
+///
+/// True when montMulBatch52 processes lanes by AVX-512 IFMA. Lane by lane
+/// it is slower than usual arithmetic of blocks, so batches of numbers
+/// should use blocks for every number instead.
+///
+bool hasMontBatch52();
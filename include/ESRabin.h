@@ -1,13 +1,46 @@
 #ifndef ESRABIN_H
 #define ESRABIN_H
 
+#include <mutex>
+#include <openssl/evp.h>
 #include "BigInt.h"
+#include "ThreadPool.h"
 
-typedef unsigned char* (hash_func_t)(const unsigned char *d, size_t n, unsigned char *md);
+///
+/// Incremental hash: data is absorbed by parts and state could be
+/// copied, so common prefix of several messages is hashed once.
+/// Context is allocated once and could be reused by `init`.
+///
+class HashContext {
+public:
+	HashContext();
+	~HashContext();
+	HashContext(const HashContext&) = delete;
+	void operator=(const HashContext&) = delete;
+	void init(const EVP_MD *md);
+	void update(const void *data, size_t size);
+	///
+	/// Take state of other context (midstate of its data).
+	///
+	void copyFrom(const HashContext &other);
+	///
+	/// Write digest and return its size, context should be
+	/// initialized again after it.
+	///
+	unsigned int final(unsigned char *digest);
+private:
+	EVP_MD_CTX *ctx;
+};
 
 class ESRabinSignature {
 	friend class ESRabinManager;
 public:
+	ESRabinSignature() {}
+	///
+	/// Signature received from other side, it should be checked.
+	///
+	ESRabinSignature(const std::string &message, const BigInt &R, const BigInt &B)
+		: message(message), R(R), B(B) {}
 	const std::string& getMessage() const { return message; }
 	const BigInt& getR() const { return R; }
 	const BigInt& getB() const { return B; }
@@ -20,12 +53,17 @@ private:
 class ESRabinPublicKey {
 	friend class ESRabinManager;
 public:
+	///
+	/// Key without module and hash is rejected by checks of signatures.
+	///
+	ESRabinPublicKey() : hash(NULL) {}
 	const BigInt& getN() const { return n; }
 	const std::string& getHash() const { return nameHashFunc; }
 private:
 	BigInt n;
 	std::string nameHashFunc;
-	hash_func_t *hash;
+	const EVP_MD *hash;
+	std::shared_ptr<const BigInt::ModContext> nContext;
 };
 
 class ESRabinPrivateKey {
@@ -36,27 +74,101 @@ public:
 private:
 	BigInt p;
 	BigInt q;
+	std::shared_ptr<const BigInt::ModContext> pContext;
+	std::shared_ptr<const BigInt::ModContext> qContext;
+	///
+	/// Recoded exponents (p + 1) / 4 and (q + 1) / 4 for square root.
+	///
+	BigInt::Exponent rootExpP;
+	BigInt::Exponent rootExpQ;
+	///
+	/// CRT coefficient q^(-1) mod p.
+	///
+	BigInt qInv;
 };
 
 class ESRabinManager {
 public:
-	ESRabinManager(RandomGenerator &gen): generator(gen) {}
+	///
+	/// `threads` is size of pool for key generation and `signMessages`,
+	/// 0 means number of CPU cores. Pool is created at the first use.
+	///
+	ESRabinManager(RandomGenerator &gen, unsigned int threads = 0)
+		: generator(gen), threads(threads) {}
 	void generateKeys(ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey);
+	///
+	/// Keys of known primes p and q, p ≡ q ≡ 3 (mod 4), p ≠ q.
+	/// Returns false and leaves keys unchanged if p or q is not 3 mod 4,
+	/// q is not invertible by module p or product does not fit to BigInt.
+	///
+	bool loadKeys(const BigInt &p, const BigInt &q,
+		      ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey);
 	void finalizeKeys(ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey);
 	void signMessage(const std::string &message, ESRabinSignature &signature,
 			 const ESRabinPublicKey &pubKey,
 			 const ESRabinPrivateKey &privKey);
+	///
+	/// Signing of many messages by pool of threads. Signature i is
+	/// signature of message i. Every worker has own workspace. Message i
+	/// is signed by stream i of generator which seed is taken from
+	/// generator of manager, so seeded generator gives the same
+	/// signatures for any amount of threads.
+	///
+	void signMessages(const std::vector<std::string> &messages,
+			  std::vector<ESRabinSignature> &signatures,
+			  const ESRabinPublicKey &pubKey,
+			  const ESRabinPrivateKey &privKey);
 	bool checkSignature(const ESRabinSignature &signature,
 			    const ESRabinPublicKey &pubKey);
+	///
+	/// Check of many signatures by pool of threads. Result i is true if
+	/// signature i is correct. Threads share only read-only context of
+	/// public module.
+	///
+	std::vector<bool> checkSignatures(const std::vector<ESRabinSignature> &signatures,
+					  const ESRabinPublicKey &pubKey);
 private:
+	///
+	/// Scratch state of one signing or checking thread.
+	///
+	struct Worker {
+		BigInt::Workspace workspace;
+		HashContext prefix;
+		HashContext hash;
+		std::vector<uint8_t> byteArray;
+	};
+
 	RandomGenerator& generator;
-	void calculateBeta(ESRabinSignature &signature,
-			   const ESRabinPublicKey &pubKey,
-			   const ESRabinPrivateKey &privKey,
-			   const BigInt &H);
+	///
+	/// Temporaries and hash contexts of single signing and checking are
+	/// reused between calls. Lock guards them and generator, so methods
+	/// could be called from several threads.
+	///
+	Worker scratch;
+	std::mutex lock;
+	unsigned int threads;
+	std::unique_ptr<ThreadPool> pool;
+	std::vector<std::unique_ptr<Worker>> workers;
+	ThreadPool& getPool();
+	static bool verifySignature(const ESRabinSignature &signature,
+				    const ESRabinPublicKey &pubKey,
+				    HashContext &hash,
+				    std::vector<uint8_t> &byteArray);
+	static void sign(const std::string &message, ESRabinSignature &signature,
+			 const ESRabinPublicKey &pubKey,
+			 const ESRabinPrivateKey &privKey,
+			 RandomGenerator &gen, BigInt::Workspace &ws,
+			 HashContext &prefix, HashContext &hash,
+			 std::vector<uint8_t> &byteArray);
+	void precomputeKeys(ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey,
+			    const BigInt &qInv);
+	static void calculateBeta(ESRabinSignature &signature,
+				  const ESRabinPrivateKey &privKey,
+				  const BigInt &H, BigInt::Workspace &ws);
 
-	void GarnerAlgorithmCRT(const BigInt &p, const BigInt &q,
-				const BigInt &Vp, const BigInt &Vq, BigInt &res);
+	static void GarnerAlgorithmCRT(const ESRabinPrivateKey &privKey,
+				       const BigInt &Vp, const BigInt &Vq, BigInt &res,
+				       BigInt::Workspace &ws);
 };
 
 #endif // ESRABIN_H
@@ -5,7 +5,9 @@
 #include <ctime>
 
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <climits>
 #include <random>
 #include "logger.h"
@@ -15,10 +17,33 @@ static_assert(sizeof(int64_t) == 8, "Need 64-bit integer for generator");
 
 class RandomGenerator {
 public:
+	virtual ~RandomGenerator() {}
 	virtual unsigned int next32bit() = 0;
+	///
+	/// Bulk generation: the same words as `count` calls of `next32bit`.
+	///
+	virtual void fill(uint32_t *words, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i) {
+			words[i] = next32bit();
+		}
+	}
 };
 
 
+///
+/// SplitMix64 step: returns the next number of sequence and moves state.
+/// Used to expand 64-bit seeds to state of generators.
+///
+inline uint64_t splitMix64(uint64_t &state)
+{
+	uint64_t z = (state += UINT64_C(0x9E3779B97F4A7C15));
+
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
 class RandomGeneratorMush : public RandomGenerator
 {
 public:
@@ -29,7 +54,38 @@ public:
 		return generator;
 	}
 
-	~RandomGeneratorMush() {LOG("New generator was destroyed.");}
+	///
+	/// 64-bit seed from std::random_device.
+	///
+	static uint64_t randomSeed()
+	{
+		std::random_device device;
+
+		return (uint64_t)device() << 32 | device();
+	}
+
+	///
+	/// Deterministic generator: state depends only on seed and number of
+	/// stream, generators of different streams of one seed are
+	/// independent. The same seed and stream give the same sequence.
+	///
+	RandomGeneratorMush(uint64_t seed, uint64_t stream)
+	{
+		// stream is mixed before it is combined with seed, so
+		// neighbour streams give unrelated states
+		uint64_t state = seed;
+		uint64_t key = stream;
+
+		state ^= splitMix64(key);
+		for (int i = 0; i < sizeA; ++i) {
+			A[i] = splitMix64(state) >> 32;
+		}
+		for (int i = 0; i < sizeB; ++i) {
+			B[i] = splitMix64(state) >> 32;
+		}
+		reset();
+	}
+
 	RandomGeneratorMush(RandomGeneratorMush const&) = delete;
 	void operator=(RandomGeneratorMush const&) = delete;
 
@@ -43,64 +99,108 @@ public:
 		}
 		runSubGeneratorA();
 		runSubGeneratorB();
-		return A[sizeA - 1] ^ B[sizeB - 1];
+		return lastA ^ lastB;
+	}
+
+	void fill(uint32_t *words, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i) {
+			words[i] = RandomGeneratorMush::next32bit();
+		}
 	}
 
 private:
 	/*
 	 * A[i] = (A[i - 55] + A[i - 24]) mod 2^32
 	 * B[i] = (B[i - 52] + B[i - 19]) mod 2^32
+	 * Arrays are circular buffers: posA and posB point to the oldest
+	 * element A[i - 55] and B[i - 52], which is replaced by the new one.
 	 */
 	const int sizeA = 55;
 	const int sizeB = 52;
 	std::array<unsigned int, 55> A;
 	std::array<unsigned int, 52> B;
+	int posA;
+	int posB;
+	unsigned int lastA;
+	unsigned int lastB;
 	bool overflowA;
 	bool overflowB;
 
-	RandomGeneratorMush()
+	RandomGeneratorMush() : RandomGeneratorMush(randomSeed(), 0)
 	{
-		std::mt19937 rng;
-		rng.seed(std::random_device()());
-		std::uniform_int_distribution<std::mt19937::result_type> dist(0, UINT_MAX);
-
-		int i;
-
-		for (i = 0; i < sizeA; ++i) {
-			A[i] = dist(rng);
-		}
+		LOG("New generator was created.");
+	}
 
-		for (i = 0; i < sizeB; ++i) {
-			B[i] = dist(rng);
-		}
+	void reset()
+	{
+		posA = 0;
+		posB = 0;
+		lastA = A[sizeA - 1];
+		lastB = B[sizeB - 1];
 		overflowA = false;
 		overflowB = false;
-		LOG("New generator was created.");
 	}
 
 	void runSubGeneratorA()
 	{
-		uint64_t A55 = (uint64_t)A[55 - 55] + (uint64_t)A[55 - 24];
+		// A[i - 24] is 31 elements after the oldest one
+		int pos24 = posA < 24 ? posA + 31 : posA - 24;
+		uint64_t A55 = (uint64_t)A[posA] + (uint64_t)A[pos24];
 
 		overflowA = A55 > UINT_MAX;
 
-		for (int i = 0; i < sizeA - 1; ++i) {
-			A[i] = A[i + 1];
-		}
-		A[sizeA - 1] = A55;
+		lastA = A[posA] = A55;
+		posA = posA + 1 == sizeA ? 0 : posA + 1;
 	}
 
 	void runSubGeneratorB()
 	{
-		uint64_t B52 = (uint64_t)B[52 - 52] + (uint64_t)B[52 - 19];
+		// B[i - 19] is 33 elements after the oldest one
+		int pos19 = posB < 19 ? posB + 33 : posB - 19;
+		uint64_t B52 = (uint64_t)B[posB] + (uint64_t)B[pos19];
 
 		overflowB = B52 > UINT_MAX;
 
-		for (int i = 0; i < sizeB - 1; ++i) {
-			B[i] = B[i + 1];
-		}
-		B[sizeB - 1] = B52;
+		lastB = B[posB] = B52;
+		posB = posB + 1 == sizeB ? 0 : posB + 1;
 	}
 };
 
+///
+/// Factory of independent Mush generators derived from one master seed.
+/// Every thread should take its own stream, the same master seed gives
+/// the same streams, so runs could be reproduced.
+///
+class RandomGeneratorStreams {
+public:
+	///
+	/// Master seed is taken from std::random_device.
+	///
+	RandomGeneratorStreams() : masterSeed(RandomGeneratorMush::randomSeed()), nextStream(0) {}
+	explicit RandomGeneratorStreams(uint64_t seed) : masterSeed(seed), nextStream(0) {}
+	RandomGeneratorStreams(RandomGeneratorStreams const&) = delete;
+	void operator=(RandomGeneratorStreams const&) = delete;
+
+	uint64_t getMasterSeed() const { return masterSeed; }
+	///
+	/// Generator of given stream.
+	///
+	std::unique_ptr<RandomGeneratorMush> create(uint64_t stream) const
+	{
+		return std::unique_ptr<RandomGeneratorMush>(new RandomGeneratorMush(masterSeed, stream));
+	}
+	///
+	/// Generator of the next stream which was not taken yet, could be
+	/// called from several threads. Streams are numbered from 0.
+	///
+	std::unique_ptr<RandomGeneratorMush> split()
+	{
+		return create(nextStream++);
+	}
+private:
+	const uint64_t masterSeed;
+	std::atomic<uint64_t> nextStream;
+};
+
 #endif // RANDOMGENERATOR_H
@@ -0,0 +1,74 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///
+/// Fixed set of worker threads with work stealing.
+/// Every worker has its own queue of index ranges, takes ranges from the
+/// back of its queue and steals from the front of other queues when its
+/// own queue is empty, so slow items do not leave other workers idle.
+///
+class ThreadPool {
+public:
+	typedef std::function<void(unsigned int worker, size_t index)> Task;
+
+	///
+	/// 0 threads means number of CPU cores.
+	///
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	void operator=(const ThreadPool&) = delete;
+	unsigned int size() const;
+	///
+	/// Run task(worker, i) for every i in [0, count) and wait for all of
+	/// them. `worker` is index of thread in [0, size()), so task could
+	/// use state of worker without locks. The first exception thrown by
+	/// task is rethrown when run is finished, the rest of range of
+	/// failed item is skipped.
+	/// Calls of `run` from several threads are executed one by one.
+	/// Call of `run` from task of the same pool could not wait for other
+	/// workers, it runs the whole nested range inline by calling worker.
+	/// Locks which caller of outer `run` holds are not released, so task
+	/// should not take them.
+	///
+	void run(size_t count, const Task &task);
+private:
+	struct Range {
+		size_t begin;
+		size_t end;
+		const Task *task;
+	};
+	struct Queue {
+		std::mutex lock;
+		std::deque<Range> ranges;
+	};
+
+	void work(unsigned int worker);
+	bool take(unsigned int worker, Range &range);
+
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> threads_;
+	std::mutex runLock_;
+	std::mutex lock_;
+	std::condition_variable start_;
+	std::condition_variable finish_;
+	///
+	/// Protected by lock_: number of run, ranges which are not finished
+	/// yet and the first error of current run.
+	///
+	unsigned long generation_;
+	size_t pending_;
+	std::exception_ptr error_;
+	bool stop_;
+};
+
+#endif // THREADPOOL_H
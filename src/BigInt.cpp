@@ -1,96 +1,586 @@
 #include <cassert>
 #include <algorithm>
+#include <utility>
 #include <math.h>
 #include "logger.h"
 #include "BigInt.h"
+#include "BigIntKernels.h"
+
+#if BIGINT_BLOCK_BITS == 64 && defined(__x86_64__)
+#include <x86intrin.h>
+#endif
 
 #define WORD_BITS			32
 #define BYTE_BITS			8
 #define HEX_CHAR_BITS			4
 
 
-/* macros for whole BigInt */
-#define BIGINT_BITS			1024
-#define BIGINT_BYTES			128	/* 1024 / 8 */
-#define BIGINT_SIZE_IN_HEX		256
+/*
+ * for 1024 bit number need
+ * 35 blocks with 30 bits digit (last block with 4 bits)
+ * 32 blocks with 32 bits digit
+ * 16 blocks with 64 bits digit
+ */
 
-#define BIGINT_DOUBLE_BITS		2048
+/* macros for usual block of BigInt */
+#define BLOCK_BITS			BIGINT_BLOCK_BITS
+#define BLOCK_TYPE_BITS			(sizeof(block) * BYTE_BITS)
+#define BLOCK_MAX_NUMBER		(~(block)0 >> (BLOCK_TYPE_BITS - BLOCK_BITS))
 
 /*
- * for 1024 bit number need 35 blocks
- * 34 blocks with 30 bits digit
- * and 1 block with 4 bits
+ * numbers shorter than KARATSUBA_THRESHOLD blocks are multiplied
+ * by schoolbook method
  */
+#ifndef KARATSUBA_THRESHOLD
+#define KARATSUBA_THRESHOLD		24
+#endif
+#if KARATSUBA_THRESHOLD < 4
+#error "Karatsuba multiplication needs threshold at least 4 blocks"
+#endif
 
-/* macros for usual block of BigInt */
-#define BLOCK_BITS			30
-#define BLOCK_CARRY_BITS		2
-#define BLOCK_MAX_NUMBER		0x3FFFFFFF
+/* enough blocks for Karatsuba scratch */
+#define KARATSUBA_SCRATCH(n)		(8 * (n) + 64)
+
+
+/**
+ * @brief 			Add two blocks with carry.
+ * @param carry			- INPUT/OUTPUT. Carry bit.
+ * @return 			sum of blocks without carry.
+ */
+static inline block addCarry(block a, block b, block &carry)
+{
+#if BIGINT_BLOCK_BITS == 64 && defined(__x86_64__)
+	unsigned long long sum;
+	carry = _addcarry_u64((unsigned char)carry, a, b, &sum);
+	return sum;
+#else
+	dblock sum = (dblock)a + b + carry;
+	carry = (block)(sum >> BLOCK_BITS);
+	return (block)sum & BLOCK_MAX_NUMBER;
+#endif
+}
+
+/**
+ * @brief 			Subtract two blocks with borrow.
+ * @param borrow		- INPUT/OUTPUT. Borrow bit.
+ * @return 			difference of blocks without borrow.
+ */
+static inline block subBorrow(block a, block b, block &borrow)
+{
+#if BIGINT_BLOCK_BITS == 64 && defined(__x86_64__)
+	unsigned long long diff;
+	borrow = _subborrow_u64((unsigned char)borrow, a, b, &diff);
+	return diff;
+#else
+	dblock diff = (dblock)a - b - borrow;
+	borrow = (block)(diff >> (2 * BLOCK_TYPE_BITS - 1));
+	return (block)diff & BLOCK_MAX_NUMBER;
+#endif
+}
+
+/**
+ * @brief 			Divide two blocks by one: (hi, lo) / d.
+ * @param hi			- INPUT. Upper block, should be less than d.
+ * @param rem			[output] Remainder of division.
+ * @return 			quotient, it fits to one block.
+ */
+static inline block divWord(block hi, block lo, block d, block &rem)
+{
+	assert(hi < d);
+#if BIGINT_BLOCK_BITS == 64 && defined(__x86_64__)
+	block q;
+	__asm__("divq %4" : "=a"(q), "=d"(rem) : "a"(lo), "d"(hi), "rm"(d));
+	return q;
+#else
+	dblock n = ((dblock)hi << BLOCK_BITS) | lo;
+	rem = (block)(n % d);
+	return (block)(n / d);
+#endif
+}
+
+/**
+ * @brief 			Position of most significant bit of non zero block.
+ */
+static inline int blockMostSignificantBit(block value)
+{
+	assert(value);
+#if BIGINT_BLOCK_BITS == 64
+	return BLOCK_TYPE_BITS - 1 - __builtin_clzll(value);
+#else
+	return BLOCK_TYPE_BITS - 1 - __builtin_clz(value);
+#endif
+}
+
+/**
+ * @brief 			Amount of trailing zero bits of non zero block.
+ */
+static inline unsigned int blockTrailingZeros(block value)
+{
+	assert(value);
+#if BIGINT_BLOCK_BITS == 64
+	return __builtin_ctzll(value);
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+/**
+ * @brief 			Add two arrays of blocks: r = a + b.
+ * 				Array a should be not shorter than b.
+ * 				r can be the same array as a or b.
+ * @return 			carry of the addition.
+ */
+static block addBlocks(block *r, const block *a, unsigned int na,
+		       const block *b, unsigned int nb)
+{
+	block carry = 0;
+	unsigned int i;
+
+	assert(na >= nb);
+
+	for (i = 0; i < nb; ++i) {
+		r[i] = addCarry(a[i], b[i], carry);
+	}
+	for (; i < na; ++i) {
+		r[i] = addCarry(a[i], 0, carry);
+	}
+	return carry;
+}
+
+/**
+ * @brief 			Subtract in place: r = r - a.
+ * 				Value of r should be not less than a.
+ */
+static void subBlocks(block *r, unsigned int nr, const block *a, unsigned int na)
+{
+	block carry = 0;
+	unsigned int i;
+
+	assert(nr >= na);
+
+	for (i = 0; i < na; ++i) {
+		r[i] = subBorrow(r[i], a[i], carry);
+	}
+	for (; carry && i < nr; ++i) {
+		r[i] = subBorrow(r[i], 0, carry);
+	}
+	assert(carry == 0);
+}
+
+/**
+ * @brief 			Schoolbook multiplication: res = a * b.
+ * @param res			[output] Array of 2 * n blocks.
+ */
+static void mulSchoolbook(const block *a, const block *b, unsigned int n, block *res)
+{
+	dblock product;
+	block carry;
+	unsigned int i, j;
+
+	memset(res, 0, 2 * n * sizeof(block));
+
+	for (i = 0; i < n; ++i) {
+		carry = 0;
+		for (j = 0; j < n; ++j) {
+			product = (dblock)a[i] * b[j] + res[i + j] + carry;
+			res[i + j] = (block)product & BLOCK_MAX_NUMBER;
+			carry = (block)(product >> BLOCK_BITS);
+		}
+		res[i + n] = carry;
+	}
+}
+
+/**
+ * @brief 			Karatsuba multiplication: res = a * b.
+ * 				Falls back to schoolbook multiplication for
+ * 				numbers shorter than KARATSUBA_THRESHOLD blocks.
+ * @param res			[output] Array of 2 * n blocks.
+ * @param scratch		- Temporary array of at least
+ * 				KARATSUBA_SCRATCH(n) blocks.
+ */
+static void mulKaratsuba(const block *a, const block *b, unsigned int n,
+			 block *res, block *scratch)
+{
+	if (n < KARATSUBA_THRESHOLD) {
+		mulSchoolbook(a, b, n, res);
+		return;
+	}
+
+	// a = a1 * 2^(h * BLOCK_BITS) + a0, the same for b
+	const unsigned int h = (n + 1) / 2;
+	const unsigned int l = n - h;
+	block *sumA = scratch;
+	block *sumB = sumA + h + 1;
+	block *mid = sumB + h + 1;
+	block *next = mid + 2 * (h + 1);
+
+	// sumA = a0 + a1, sumB = b0 + b1
+	sumA[h] = addBlocks(sumA, a, h, a + h, l);
+	sumB[h] = addBlocks(sumB, b, h, b + h, l);
+
+	// mid = (a0 + a1) * (b0 + b1)
+	mulKaratsuba(sumA, sumB, h + 1, mid, next);
+
+	// res = a1 * b1 * 2^(2h * BLOCK_BITS) + a0 * b0
+	mulKaratsuba(a, b, h, res, next);
+	mulKaratsuba(a + h, b + h, l, res + 2 * h, next);
+
+	// mid = a0 * b1 + a1 * b0
+	subBlocks(mid, 2 * (h + 1), res, 2 * h);
+	subBlocks(mid, 2 * (h + 1), res + 2 * h, 2 * l);
+
+	block carry = addBlocks(res + h, res + h, 2 * n - h, mid, std::min(2 * (h + 1), 2 * n - h));
+	assert(carry == 0);
+	(void)carry;
+}
+
+/**
+ * @brief 			Shift array of blocks to the left: r = a << shift.
+ * @param shift			- INPUT. Less than BLOCK_BITS.
+ * @return 			bits shifted out of the most significant block.
+ */
+static block shiftBlocksLeft(block *r, const block *a, unsigned int n, unsigned int shift)
+{
+	block out = 0;
+	unsigned int i;
+
+	assert(shift < BLOCK_BITS);
+
+	if (shift == 0) {
+		std::copy(a, a + n, r);
+		return 0;
+	}
+	out = a[n - 1] >> (BLOCK_BITS - shift);
+	for (i = n - 1; i > 0; --i) {
+		r[i] = ((a[i] << shift) | (a[i - 1] >> (BLOCK_BITS - shift))) & BLOCK_MAX_NUMBER;
+	}
+	r[0] = (a[0] << shift) & BLOCK_MAX_NUMBER;
+	return out;
+}
+
+/**
+ * @brief 			Shift array of blocks to the right: r = a >> shift.
+ * @param shift			- INPUT. Less than BLOCK_BITS.
+ */
+static void shiftBlocksRight(block *r, const block *a, unsigned int n, unsigned int shift)
+{
+	unsigned int i;
+
+	assert(shift < BLOCK_BITS);
+
+	if (shift == 0) {
+		std::copy(a, a + n, r);
+		return;
+	}
+	for (i = 0; i < n - 1; ++i) {
+		r[i] = ((a[i] >> shift) | (a[i + 1] << (BLOCK_BITS - shift))) & BLOCK_MAX_NUMBER;
+	}
+	r[n - 1] = a[n - 1] >> shift;
+}
+
+/**
+ * @brief 			Schoolbook squaring: res = a * a.
+ * 				Every cross product a[i] * a[j] is computed once
+ * 				and doubled by shift, so squaring needs about
+ * 				half of multiplications of mulSchoolbook.
+ * @param res			[output] Array of 2 * n blocks.
+ */
+static void sqrSchoolbook(const block *a, unsigned int n, block *res)
+{
+	dblock product;
+	block carry;
+	unsigned int i, j;
+
+	memset(res, 0, 2 * n * sizeof(block));
+
+	// res = sum of a[i] * a[j] for i < j
+	for (i = 0; i + 1 < n; ++i) {
+		const block ai = a[i];
+		carry = 0;
+		for (j = i + 1; j < n; ++j) {
+			product = (dblock)ai * a[j] + res[i + j] + carry;
+			res[i + j] = (block)product & BLOCK_MAX_NUMBER;
+			carry = (block)(product >> BLOCK_BITS);
+		}
+		res[i + n] = carry;
+	}
+
+	// cross products are less than a^2 / 2, so nothing is shifted out
+	shiftBlocksLeft(res, res, 2 * n, 1);
+
+	// add squares of blocks
+	carry = 0;
+	for (i = 0; i < n; ++i) {
+		product = (dblock)a[i] * a[i] + res[2 * i] + carry;
+		res[2 * i] = (block)product & BLOCK_MAX_NUMBER;
+		product = (product >> BLOCK_BITS) + res[2 * i + 1];
+		res[2 * i + 1] = (block)product & BLOCK_MAX_NUMBER;
+		carry = (block)(product >> BLOCK_BITS);
+	}
+	assert(carry == 0);
+}
+
+/**
+ * @brief 			Long division of arrays of blocks
+ * 				(Knuth, TAOCP vol. 2, Algorithm D).
+ * @param u			- INPUT/OUTPUT. Normalized dividend of nu blocks,
+ * 				the most significant block could be zero.
+ * 				First n blocks will contain normalized remainder.
+ * @param v			- INPUT. Normalized divisor of n > 1 blocks,
+ * 				the most significant bit of v[n - 1] is set.
+ * @param q			[output] Quotient of nu - n blocks.
+ */
+static void divBlocks(block *u, unsigned int nu, const block *v, unsigned int n, block *q)
+{
+	dblock qhat, rhat, product;
+	block carry, borrow;
+	unsigned int i;
+	int j;
+
+	assert(n > 1 && nu > n);
+
+	for (j = nu - n - 1; j >= 0; --j) {
+		// estimate quotient block by two upper blocks of remainder
+		qhat = (((dblock)u[j + n] << BLOCK_BITS) | u[j + n - 1]) / v[n - 1];
+		rhat = (((dblock)u[j + n] << BLOCK_BITS) | u[j + n - 1]) % v[n - 1];
+		while (qhat > BLOCK_MAX_NUMBER ||
+		       qhat * v[n - 2] > ((rhat << BLOCK_BITS) | u[j + n - 2])) {
+			--qhat;
+			rhat += v[n - 1];
+			if (rhat > BLOCK_MAX_NUMBER) {
+				break;
+			}
+		}
+
+		// u = u - qhat * v * 2^(j * BLOCK_BITS)
+		carry = 0;
+		borrow = 0;
+		for (i = 0; i < n; ++i) {
+			product = qhat * v[i] + carry;
+			carry = (block)(product >> BLOCK_BITS);
+			u[i + j] = subBorrow(u[i + j], (block)product & BLOCK_MAX_NUMBER, borrow);
+		}
+		u[j + n] = subBorrow(u[j + n], carry, borrow);
+
+		// qhat was one more than needed, add divisor back
+		if (borrow) {
+			--qhat;
+			carry = 0;
+			for (i = 0; i < n; ++i) {
+				u[i + j] = addCarry(u[i + j], v[i], carry);
+			}
+			u[j + n] = (u[j + n] + carry) & BLOCK_MAX_NUMBER;
+		}
+		q[j] = (block)qhat;
+	}
+}
 
+/**
+ * @brief 			Compare two arrays of n blocks.
+ * @return 			1 if a > b, -1 if a < b, 0 if they are equal.
+ */
+static int cmpBlocks(const block *a, const block *b, unsigned int n)
+{
+	while (n-- > 0) {
+		if (a[n] != b[n]) {
+			return a[n] > b[n] ? 1 : -1;
+		}
+	}
+	return 0;
+}
 
-BigInt::BigInt(unsigned int lengthBits):
-	length_(lengthBits),
-	size_(ceil(lengthBits / (float)BLOCK_BITS)),
-	countBistLastBlock_(lengthBits % BLOCK_BITS),
-	maxValueLastBlock_(fillBits(countBistLastBlock_))
+/**
+ * @brief 			Multiply and add: r = r + a * t.
+ * @return 			carry of the addition.
+ */
+static block mulAddBlocks(block *r, const block *a, unsigned int n, block t)
 {
-	assert(lengthBits == BIGINT_BITS || lengthBits == BIGINT_DOUBLE_BITS);
+	dblock product;
+	block carry = 0;
+
+	for (unsigned int i = 0; i < n; ++i) {
+		product = (dblock)a[i] * t + r[i] + carry;
+		r[i] = (block)product & BLOCK_MAX_NUMBER;
+		carry = (block)(product >> BLOCK_BITS);
+	}
+	return carry;
+}
 
-//	INFO("Create BigInt with length {}, size {}, countBistLastBlock {},"
-//			"maxValueLastBlock_ {:X}",
-//			length_, size_, countBistLastBlock_, maxValueLastBlock_);
+/**
+ * @brief 			Modular subtraction: x = x - y mod m.
+ * @param x, y			- Arrays of s + 1 blocks, less than m.
+ * @param m			- INPUT. Module of s blocks.
+ */
+static void subModBlocks(block *x, const block *y, const block *m, unsigned int s)
+{
+	if (cmpBlocks(x, y, s + 1) == -1) {
+		x[s] += addBlocks(x, x, s, m, s);
+	}
+	subBlocks(x, s + 1, y, s + 1);
+}
 
-	blocks_ = new block[size_];
-	memset(blocks_, 0, sizeof(block) * size_);
-	preComputedTable_ = NULL;
-	posMostSignBit_ = -1;
+/**
+ * @brief 			Remove trailing zero bits of u: u = u / 2^k,
+ * 				and keep x * a = u mod m: x = x * 2^(-k) mod m.
+ * @param u			- INPUT/OUTPUT. Non zero array of len blocks.
+ * @param x			- INPUT/OUTPUT. Array of s + 1 blocks, less than m.
+ * @param m			- INPUT. Odd module of s blocks.
+ * @param mInv			- INPUT. -m^(-1) mod 2^BLOCK_BITS.
+ */
+static void shiftOutZeros(block *u, unsigned int len, block *x, const block *m,
+			  unsigned int s, block mInv)
+{
+	unsigned int k;
+	block t;
+
+	while ((u[0] & 1) == 0) {
+		k = u[0] ? blockTrailingZeros(u[0]) : BLOCK_BITS - 1;
+		k = std::min(k, (unsigned int)BLOCK_BITS - 1);
+		shiftBlocksRight(u, u, len, k);
+
+		// lower k bits of x + t * m are zero
+		t = (x[0] * mInv) & (((block)1 << k) - 1);
+		x[s] += mulAddBlocks(x, m, s, t);
+		shiftBlocksRight(x, x, s + 1, k);
+		// x < 2m
+		if (x[s] || cmpBlocks(x, m, s) != -1) {
+			subBlocks(x, s + 1, m, s);
+		}
+	}
 }
 
-BigInt::BigInt() : BigInt(BIGINT_BITS)
+template <unsigned int Bits>
+const unsigned int FixedBigInt<Bits>::length_;
+template <unsigned int Bits>
+const unsigned int FixedBigInt<Bits>::size_;
+template <unsigned int Bits>
+const unsigned int FixedBigInt<Bits>::countBistLastBlock_;
+template <unsigned int Bits>
+const block FixedBigInt<Bits>::maxValueLastBlock_;
+
+template <unsigned int Bits>
+FixedBigInt<Bits>::FixedBigInt() : blocks_()
 {
+	static_assert(Bits % WORD_BITS == 0, "Length of number should be multiple of 32");
+
+	context_ = NULL;
 }
 
-BigInt::BigInt(const char *strHexNumber) : BigInt()
+template <unsigned int Bits>
+FixedBigInt<Bits>::FixedBigInt(const char *strHexNumber) : FixedBigInt()
 {
 	if (fromString(strHexNumber)) {
 		WARN("Can not convert from string. Check your string.");
 	}
 }
 
-BigInt::BigInt(std::string &strHexNumber) : BigInt()
+template <unsigned int Bits>
+FixedBigInt<Bits>::FixedBigInt(std::string &strHexNumber) : FixedBigInt()
 {
 	if (fromString(strHexNumber)) {
 		WARN("Can not convert from string. Check your string.");
 	}
 }
 
-BigInt::BigInt(BigInt&& number) : length_(number.length_), size_(number.size_),
-	countBistLastBlock_(number.countBistLastBlock_),
-	maxValueLastBlock_(number.countBistLastBlock_)
+template <unsigned int Bits>
+FixedBigInt<Bits>::FixedBigInt(const FixedBigInt &number) : FixedBigInt()
 {
-	DEBUG("Move constructor called");
-
 	blocks_ = number.blocks_;
-	number.blocks_ = nullptr;
 }
 
-BigInt::~BigInt() { delete[] blocks_; }
+template <unsigned int Bits>
+FixedBigInt<Bits>::FixedBigInt(FixedBigInt&& number) : FixedBigInt()
+{
+	*this = std::move(number);
+}
+
+template <unsigned int Bits>
+template <unsigned int B>
+FixedBigInt<Bits>::FixedBigInt(const FixedBigInt<B> &number) : FixedBigInt()
+{
+	assert(number.getPosMostSignificatnBit() < (int)length_);
+	copyContent(number);
+}
+
+template <unsigned int Bits>
+FixedBigInt<Bits>& FixedBigInt<Bits>::operator=(const FixedBigInt &number)
+{
+	if (this != &number) {
+		context_ = NULL;
+		ownContext_.reset();
+		blocks_ = number.blocks_;
+	}
+	return *this;
+}
+
+template <unsigned int Bits>
+FixedBigInt<Bits>& FixedBigInt<Bits>::operator=(FixedBigInt&& number)
+{
+	if (this != &number) {
+		blocks_ = number.blocks_;
+		context_ = number.context_;
+		ownContext_ = std::move(number.ownContext_);
+		number.context_ = NULL;
+	}
+	return *this;
+}
+
+template <unsigned int Bits>
+FixedBigInt<Bits> FixedBigInt<Bits>::operator+(const FixedBigInt &y) const
+{
+	FixedBigInt res(*this);
+	res.add(y);
+	return res;
+}
+
+template <unsigned int Bits>
+FixedBigInt<Bits> FixedBigInt<Bits>::operator-(const FixedBigInt &y) const
+{
+	FixedBigInt res(*this);
+	res.sub(y);
+	return res;
+}
+
+template <unsigned int Bits>
+typename FixedBigInt<Bits>::Double FixedBigInt<Bits>::operator*(const FixedBigInt &y) const
+{
+	Double res;
+	mul(y, res);
+	return res;
+}
 
-BigInt* BigInt::getDoubleNumber()
+template <unsigned int Bits>
+template <unsigned int B>
+FixedBigInt<B> FixedBigInt<Bits>::operator%(const FixedBigInt<B> &m) const
 {
-	return new BigInt(BIGINT_DOUBLE_BITS);
+	static_assert(B <= Bits && Bits <= 2 * B, "Module is too short for the number");
+
+	FixedBigInt<B> res;
+	if (m.context_ && getPosMostSignificatnBit() <= 2 * m.context_->posMostSignBit_ + 1) {
+		FixedBigInt r(*this);
+		r.mod(*m.context_);
+		res.copyContent(r);
+	} else {
+		FixedBigInt y, q, r;
+		y.copyContent(m);
+		div(y, q, r);
+		res.copyContent(r);
+	}
+	return res;
 }
 
-unsigned int BigInt::getLength()
+template <unsigned int Bits>
+unsigned int FixedBigInt<Bits>::getLength()
 {
 	return length_;
 }
 
-int BigInt::fromString(const char *hexStr)
+template <unsigned int Bits>
+int FixedBigInt<Bits>::fromString(const char *hexStr)
 {
 	int i = 0;
 	size_t maxAmountChars = length_ / HEX_CHAR_BITS;
-	std::vector<block> rawArray(length_ / WORD_BITS);
+	std::vector<uint32_t> rawArray(length_ / WORD_BITS);
 	std::fill(rawArray.begin(), rawArray.end(), 0);
 
 	if (strlen(hexStr) > maxAmountChars) {
@@ -109,7 +599,7 @@ int BigInt::fromString(const char *hexStr)
 	i = (int)strlen(hexStr) - 1;
 	for (; i >= 0 && indexArray < rawArray.size(); --i) {
 		int digit = hexCharToInteger(hexStr[i]);
-		rawArray[indexArray] += digit << 4 * shiftPos;
+		rawArray[indexArray] += (uint32_t)digit << 4 * shiftPos;
 		++shiftPos;
 		if (shiftPos % 8 == 0) {
 			++indexArray;
@@ -125,16 +615,18 @@ int BigInt::fromString(const char *hexStr)
 	return 0;
 }
 
-int BigInt::fromString(const std::string &hexString)
+template <unsigned int Bits>
+int FixedBigInt<Bits>::fromString(const std::string &hexString)
 {
 	return fromString(hexString.c_str());
 }
 
-std::string BigInt::toString() const
+template <unsigned int Bits>
+std::string FixedBigInt<Bits>::toString() const
 {
 	std::string output("");
 	unsigned int i = 0;
-	std::vector<block> rawArray(length_ / WORD_BITS);
+	std::vector<uint32_t> rawArray(length_ / WORD_BITS);
 	std::fill(rawArray.begin(), rawArray.end(), 0);
 
 	blocksToRawArray(rawArray);
@@ -148,17 +640,18 @@ std::string BigInt::toString() const
 	return output;
 }
 
-void BigInt::fromByteArray(unsigned char *data, size_t size)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::fromByteArray(unsigned char *data, size_t size)
 {
-	if (size > BIGINT_BYTES) {
+	if (size > length_ / BYTE_BITS) {
 		throw std::length_error("Byte array too long.");
 	}
-	std::vector<block> rawArray(length_ / WORD_BITS);
+	std::vector<uint32_t> rawArray(length_ / WORD_BITS);
 	unsigned int indexArray = 0;
 	unsigned int shiftPos = 0;
 
 	for (int i = size - 1; i >= 0 && indexArray < rawArray.size(); --i) {
-		rawArray[indexArray] += data[i] << 8 * shiftPos;
+		rawArray[indexArray] += (uint32_t)data[i] << 8 * shiftPos;
 		++shiftPos;
 		if (shiftPos % 4 == 0) {
 			++indexArray;
@@ -175,7 +668,8 @@ void BigInt::fromByteArray(unsigned char *data, size_t size)
  * @return 			integer in range [0 - 15] when successful and
  * 				-1 if error occurred.
  */
-int BigInt::hexCharToInteger(char digit)
+template <unsigned int Bits>
+int FixedBigInt<Bits>::hexCharToInteger(char digit)
 {
 	if (digit >= '0' && digit <= '9') {
 		return digit - '0' ;
@@ -187,7 +681,8 @@ int BigInt::hexCharToInteger(char digit)
 	return -1;
 }
 
-char BigInt::integerToHexChar(int symbol) const
+template <unsigned int Bits>
+char FixedBigInt<Bits>::integerToHexChar(int symbol) const
 {
 	assert(symbol >= 0x0 && symbol <= 0xF);
 	if (symbol >= 0 && symbol <= 9) {
@@ -197,38 +692,29 @@ char BigInt::integerToHexChar(int symbol) const
 	}
 }
 
-void BigInt::rawArrayToBlocks(std::vector<block> &rawArray)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::rawArrayToBlocks(std::vector<uint32_t> &rawArray)
 {
-	unsigned int leftBits = 0;
-	block temp = 0;
-
+	dblock acquired = 0;
+	unsigned int acquiredBits = 0;
 	unsigned int indexRaw = 0;
 	unsigned int indexBlocks = 0;
 
-	for(; indexRaw < rawArray.size(); ++indexRaw, ++indexBlocks) {
-		temp = 0;
-		if (leftBits) {
-			temp = rawArray[indexRaw - 1] >> (WORD_BITS - leftBits);
-			if (leftBits == BLOCK_BITS) {
-				blocks_[indexBlocks] = temp;
-				--indexRaw;
-				leftBits = 0;
-				//DEBUG("30 bits| temp = {:X}", temp);
-				continue;
-			}
+	for (; indexRaw < rawArray.size(); ++indexRaw) {
+		acquired |= (dblock)rawArray[indexRaw] << acquiredBits;
+		acquiredBits += WORD_BITS;
+		while (acquiredBits >= BLOCK_BITS) {
+			blocks_[indexBlocks++] = (block)acquired & BLOCK_MAX_NUMBER;
+			acquired >>= BLOCK_BITS;
+			acquiredBits -= BLOCK_BITS;
 		}
-		blocks_[indexBlocks] = (rawArray[indexRaw] <<
-				(leftBits + BLOCK_CARRY_BITS));
-		blocks_[indexBlocks] >>= BLOCK_CARRY_BITS;
-		//DEBUG("T: {:X} and {:X}", blocks_[indexBlocks], temp);
-		blocks_[indexBlocks] += temp;
-		leftBits += BLOCK_CARRY_BITS;
 	}
 
-	assert(leftBits == countBistLastBlock_);
-	assert(indexBlocks == size_ - 1);
-
-	blocks_[indexBlocks] = rawArray[indexRaw - 1] >> (WORD_BITS - leftBits);
+	if (indexBlocks < size_) {
+		assert(acquiredBits == countBistLastBlock_);
+		assert(indexBlocks == size_ - 1);
+		blocks_[indexBlocks] = (block)acquired;
+	}
 }
 
 /**
@@ -236,84 +722,79 @@ void BigInt::rawArrayToBlocks(std::vector<block> &rawArray)
  * 				human readable format.
  * @param rawArray		[output] Array for numbers.
  */
-void BigInt::blocksToRawArray(std::vector<block> &rawArray) const
+template <unsigned int Bits>
+void FixedBigInt<Bits>::blocksToRawArray(std::vector<uint32_t> &rawArray) const
 {
+	dblock acquired = 0;
 	unsigned int acquiredBits = 0;
-	int indexBlocks = 0;
-	int indexRaw = 0;
-	int sizeRawArray = rawArray.size();
-	block temp = 0;
+	unsigned int indexBlocks = 0;
+	unsigned int indexRaw = 0;
 
-	for(; indexRaw < sizeRawArray; ++indexBlocks, ++indexRaw) {
-		if(acquiredBits == BLOCK_BITS) {
-			++indexBlocks;
-			acquiredBits = 0;
+	for (; indexRaw < rawArray.size(); ++indexRaw) {
+		while (acquiredBits < WORD_BITS && indexBlocks < size_) {
+			acquired |= (dblock)blocks_[indexBlocks++] << acquiredBits;
+			acquiredBits += BLOCK_BITS;
 		}
-		rawArray[indexRaw] = blocks_[indexBlocks] >> acquiredBits;
-		temp = blocks_[indexBlocks + 1] <<
-			(WORD_BITS - acquiredBits - BLOCK_CARRY_BITS);
-		rawArray[indexRaw] += temp;
-		acquiredBits += BLOCK_CARRY_BITS;
+		rawArray[indexRaw] = (uint32_t)acquired;
+		acquired >>= WORD_BITS;
+		acquiredBits -= WORD_BITS;
 	}
 }
 
-int BigInt::getPosMostSignificatnBit() const
+template <unsigned int Bits>
+int FixedBigInt<Bits>::getPosMostSignificatnBit() const
 {
 	int i;
-	int position = length_ - 1;
 
-	if (blocks_[size_ - 1]) {
-		assert(blocks_[size_ - 1] <= maxValueLastBlock_);
-		return position - (__builtin_clz(blocks_[size_ - 1]) - (WORD_BITS - countBistLastBlock_));
-	}
-	position -= countBistLastBlock_;
+	assert(blocks_[size_ - 1] <= maxValueLastBlock_);
 
-	for (i = size_ - 2; i >= 0 && blocks_[i] == 0; --i) {
-		position -= BLOCK_BITS;
+	for (i = size_ - 1; i >= 0 && blocks_[i] == 0; --i) {
 	}
 	if (i == -1) {
 		// number is zero
 		return -1;
-	} else {
-		assert(blocks_[i] <= BLOCK_MAX_NUMBER);
-		return position - (__builtin_clz(blocks_[i]) - (WORD_BITS - BLOCK_BITS));
 	}
+	assert(blocks_[i] <= BLOCK_MAX_NUMBER);
+	return i * BLOCK_BITS + blockMostSignificantBit(blocks_[i]);
 }
 
-int BigInt::isEqual(const BigInt &number)
+template <unsigned int Bits>
+template <unsigned int B>
+int FixedBigInt<Bits>::isEqual(const FixedBigInt<B> &number) const
 {
-	block *end, *start;
+	const block *end, *start;
 
 	if (size_ == number.size_) {
-		return std::equal(blocks_, blocks_ + size_, number.blocks_);
+		return std::equal(blocks_.data(), blocks_.data() + size_, number.blocks_.data());
 	} else if (size_ > number.size_) {
-		start = blocks_ + number.size_;
-		end = blocks_ + size_;
+		start = blocks_.data() + number.size_;
+		end = blocks_.data() + size_;
 		while (start != end) {
 			if (*start++ != 0) {
 				return false;
 			}
 		}
-		return std::equal(blocks_, blocks_ + number.size_, number.blocks_);
+		return std::equal(blocks_.data(), blocks_.data() + number.size_, number.blocks_.data());
 	} else {
-		start = number.blocks_ + size_;
-		end = number.blocks_ + number.size_;
+		start = number.blocks_.data() + size_;
+		end = number.blocks_.data() + number.size_;
 		while (start != end) {
 
 			if (*start++ != 0) {
 				return false;
 			}
 		}
-		return std::equal(blocks_, blocks_ + size_, number.blocks_);
+		return std::equal(blocks_.data(), blocks_.data() + size_, number.blocks_.data());
 	}
 }
 
-bool BigInt::isZero() const
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::isZero() const
 {
 	//block toCmp[size_] = {0};
 	//return !memcmp(blocks_, toCmp, size_ * sizeof(block));
-	block *start = blocks_;
-	block *end = blocks_ + size_;
+	const block *start = blocks_.data();
+	const block *end = blocks_.data() + size_;
 	while (start != end) {
 		if (*start) {
 			return false;
@@ -323,34 +804,39 @@ bool BigInt::isZero() const
 	return true;
 }
 
-void BigInt::setMax()
+template <unsigned int Bits>
+void FixedBigInt<Bits>::setMax()
 {
-	std::fill(blocks_, blocks_ + size_ - 1, BLOCK_MAX_NUMBER);
+	std::fill(blocks_.data(), blocks_.data() + size_ - 1, BLOCK_MAX_NUMBER);
 	blocks_[size_ - 1] = maxValueLastBlock_;
 }
 
-void BigInt::setZero()
+template <unsigned int Bits>
+void FixedBigInt<Bits>::setZero()
 {
-	memset(blocks_, 0, size_ * sizeof(block));
+	memset(blocks_.data(), 0, size_ * sizeof(block));
 }
 
-void BigInt::setNumber(unsigned int number)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::setNumber(unsigned int number)
 {
-	memset(blocks_ + 1, 0, (size_ - 1) * sizeof(block));
+	memset(blocks_.data() + 1, 0, (size_ - 1) * sizeof(block));
 	blocks_[0] = number;
 }
 
-block BigInt::fillBits(unsigned int amountBits)
+template <unsigned int Bits>
+block FixedBigInt<Bits>::fillBits(unsigned int amountBits)
 {
-	block number = 0;
+	assert(amountBits <= BLOCK_TYPE_BITS);
 
-	for (unsigned int i = 0; i < amountBits; ++i) {
-		number += (1 << i);
+	if (amountBits == BLOCK_TYPE_BITS) {
+		return ~(block)0;
 	}
-	return number;
+	return ((block)1 << amountBits) - 1;
 }
 
-void BigInt::shiftLeftBlock(unsigned int countBits)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::shiftLeftBlock(unsigned int countBits)
 {
 	assert(countBits <= BLOCK_BITS);
 
@@ -358,6 +844,17 @@ void BigInt::shiftLeftBlock(unsigned int countBits)
 	block temp = 0;
 	unsigned int i = 0;
 
+	if (countBits == 0) {
+		return;
+	}
+	if (countBits == BLOCK_BITS) {
+		// move whole blocks
+		memmove(blocks_.data() + 1, blocks_.data(), (size_ - 1) * sizeof(block));
+		blocks_[0] = 0;
+		blocks_[size_ - 1] &= maxValueLastBlock_;
+		return;
+	}
+
 	for (i = 0; i < size_ - 1; ++i) {
 		// acquire carry bits from current block
 		temp = blocks_[i] >> (BLOCK_BITS - countBits);
@@ -372,7 +869,8 @@ void BigInt::shiftLeftBlock(unsigned int countBits)
 	blocks_[i] &= maxValueLastBlock_;
 }
 
-void BigInt::shiftLeft(unsigned int countBits)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::shiftLeft(unsigned int countBits)
 {
 	if (countBits >= length_) {
 		setZero();
@@ -386,13 +884,24 @@ void BigInt::shiftLeft(unsigned int countBits)
 	shiftLeftBlock(countBits);
 }
 
-void BigInt::shiftRightBlock(unsigned int countBits)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::shiftRightBlock(unsigned int countBits)
 {
 	assert(countBits <= BLOCK_BITS);
 	unsigned int i = 0;
 	block maxCarryBlock = fillBits(countBits);
 	block carryBits = 0;
 
+	if (countBits == 0) {
+		return;
+	}
+	if (countBits == BLOCK_BITS) {
+		// move whole blocks
+		memmove(blocks_.data(), blocks_.data() + 1, (size_ - 1) * sizeof(block));
+		blocks_[size_ - 1] = 0;
+		return;
+	}
+
 	blocks_[0] >>= countBits;
 	for (i = 1; i < size_; ++i) {
 		carryBits = blocks_[i] & maxCarryBlock;
@@ -401,7 +910,8 @@ void BigInt::shiftRightBlock(unsigned int countBits)
 	}
 }
 
-void BigInt::shiftRightBit()
+template <unsigned int Bits>
+void FixedBigInt<Bits>::shiftRightBit()
 {
 	unsigned int i = 0;
 	block carryBit = 0;
@@ -414,7 +924,8 @@ void BigInt::shiftRightBit()
 	}
 }
 
-void BigInt::shiftRight(unsigned int countBits)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::shiftRight(unsigned int countBits)
 {
 	if (countBits >= length_) {
 		setZero();
@@ -432,7 +943,9 @@ void BigInt::shiftRight(unsigned int countBits)
 /// -1 if this < number
 ///  0 if this == number
 ///
-int BigInt::cmp(const BigInt &number) const
+template <unsigned int Bits>
+template <unsigned int B>
+int FixedBigInt<Bits>::cmp(const FixedBigInt<B> &number) const
 {
 	unsigned int i = 0;
 	unsigned int size = size_;
@@ -455,14 +968,15 @@ int BigInt::cmp(const BigInt &number) const
 		size = size_;
 	}
 
-	diff = blocks_[size - 1] - number.blocks_[size - 1];
-	for (j = size - 2; j >= 0 && diff == 0; --j) {
-		diff = blocks_[j] - number.blocks_[j];
+	for (j = size - 1; j >= 0 && diff == 0; --j) {
+		diff = blocks_[j] > number.blocks_[j] ? 1 :
+		       blocks_[j] < number.blocks_[j] ? -1 : 0;
 	}
-	return diff > 0 ? 1 : diff < 0 ? -1 : 0;
+	return diff;
 }
 
-int BigInt::cmp(block number) const
+template <unsigned int Bits>
+int FixedBigInt<Bits>::cmp(block number) const
 {
 	if (blocks_[0] > number) {
 		return 1;
@@ -475,7 +989,8 @@ int BigInt::cmp(block number) const
 	return blocks_[0] == number ? 0 : -1;
 }
 
-void BigInt::setBit(unsigned int position, unsigned int value) const
+template <unsigned int Bits>
+void FixedBigInt<Bits>::setBit(unsigned int position, unsigned int value)
 {
 	assert((value & 1) == value);
 	assert(position >= 0 && position < length_);
@@ -483,7 +998,7 @@ void BigInt::setBit(unsigned int position, unsigned int value) const
 	int posInBlock = position % BLOCK_BITS;
 	int posBlock = position / BLOCK_BITS;
 
-	block temp = (~(1 << posInBlock)) & BLOCK_MAX_NUMBER;
+	block temp = (~((block)1 << posInBlock)) & BLOCK_MAX_NUMBER;
 	// reset needed bit
 	blocks_[posBlock] &= temp;
 	// set new value
@@ -491,43 +1006,45 @@ void BigInt::setBit(unsigned int position, unsigned int value) const
 	assert(blocks_[size_ - 1] <= maxValueLastBlock_);
 }
 
-int BigInt::getBit(unsigned int position) const
+template <unsigned int Bits>
+int FixedBigInt<Bits>::getBit(unsigned int position) const
 {
 	assert(position >= 0 && position <= length_);
 
 	block neededBlock = blocks_[position / BLOCK_BITS];
 	int posInBlock = position % BLOCK_BITS;
-	return (neededBlock & ( 1 << posInBlock )) >> posInBlock;
+	return (neededBlock >> posInBlock) & 1;
 }
 
-int BigInt::clearBit(unsigned int position)
+template <unsigned int Bits>
+int FixedBigInt<Bits>::clearBit(unsigned int position)
 {
 	block neededBlock = blocks_[position / BLOCK_BITS];
 	int posInBlock = position % BLOCK_BITS;
 
 	int bit = (neededBlock >> posInBlock) & 1;
-	blocks_[position / BLOCK_BITS] &= ~(1 << posInBlock);
+	blocks_[position / BLOCK_BITS] &= ~((block)1 << posInBlock);
 	return bit;
 }
 
-BigInt* BigInt::copy() const
+template <unsigned int Bits>
+FixedBigInt<Bits>* FixedBigInt<Bits>::copy() const
 {
-	BigInt *number = new BigInt(length_);
-	unsigned int i;
+	FixedBigInt *number = new FixedBigInt();
 
-	for (i = 0; i < size_; ++i) {
-		number->blocks_[i] = blocks_[i];
-	}
+	number->blocks_ = blocks_;
 	return number;
 }
 
-void BigInt::copyContent(const BigInt &number)
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::copyContent(const FixedBigInt<B> &number)
 {
-	block *thisData = blocks_;
-	block *thisEnd = blocks_ + size_;
+	block *thisData = blocks_.data();
+	block *thisEnd = blocks_.data() + size_;
 
-	block *mData = number.blocks_;
-	block *mEnd = number.blocks_ + number.size_;
+	const block *mData = number.blocks_.data();
+	const block *mEnd = number.blocks_.data() + number.size_;
 
 
 	while (thisData != thisEnd && mData != mEnd) {
@@ -536,7 +1053,9 @@ void BigInt::copyContent(const BigInt &number)
 	blocks_[size_ - 1] &= maxValueLastBlock_;
 }
 
-bool BigInt::add(const BigInt &number)
+template <unsigned int Bits>
+template <unsigned int B>
+bool FixedBigInt<Bits>::add(const FixedBigInt<B> &number)
 {
 	assert(size_ >= number.size_);
 
@@ -544,64 +1063,38 @@ bool BigInt::add(const BigInt &number)
 	unsigned int i = 0;
 
 	for(i = 0 ; i < number.size_; ++i) {
-		blocks_[i] += number.blocks_[i] + carry;
-		carry = !!(blocks_[i] & ~BLOCK_MAX_NUMBER);
-		blocks_[i] &= BLOCK_MAX_NUMBER;
-		//assert((carry & 1) == carry);
+		blocks_[i] = addCarry(blocks_[i], number.blocks_[i], carry);
 	}
-
-	if (size_ == number.size_) {
-		carry = !!(blocks_[number.size_ - 1] & ~maxValueLastBlock_);
-		blocks_[number.size_ - 1] &= maxValueLastBlock_;
-	} else {
-		for (i = number.size_; i < size_ - 1; ++i) {
-			blocks_[i] += carry;
-			carry = !!(blocks_[i] & ~BLOCK_MAX_NUMBER);
-			blocks_[i] &= BLOCK_MAX_NUMBER;
-			//assert((carry & 1) == carry);
-		}
-		carry = !!(blocks_[size_ - 1] & ~maxValueLastBlock_);
-		blocks_[size_ - 1] &= maxValueLastBlock_;
+	for (; i < size_; ++i) {
+		blocks_[i] = addCarry(blocks_[i], 0, carry);
 	}
-	//assert((carry & 1) == carry);
+
+	// carry out of the last block
+	carry |= !!(blocks_[size_ - 1] & ~maxValueLastBlock_);
+	blocks_[size_ - 1] &= maxValueLastBlock_;
 	return carry;
 }
 
-void BigInt::sub(const BigInt &number)
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::sub(const FixedBigInt<B> &number)
 {
 	assert(size_ >= number.size_);
 
-	block setterCarryBit = BLOCK_MAX_NUMBER + (block)1;
-	block carryBit = 0;
+	block borrow = 0;
 	unsigned int i = 0;
 
-	assert(setterCarryBit == ((block)1 << BLOCK_BITS));
-
 	for (i = 0; i < number.size_; ++i) {
-		blocks_[i] |= setterCarryBit;
-		blocks_[i] -= number.blocks_[i] + carryBit;
-		carryBit = !(blocks_[i] >> BLOCK_BITS);
-		blocks_[i] &= BLOCK_MAX_NUMBER;
-		assert((carryBit & 1) == carryBit);
+		blocks_[i] = subBorrow(blocks_[i], number.blocks_[i], borrow);
 	}
-	if (size_ == number.size_) {
-		// for last block if nubers are equals
-		blocks_[size_ - 1] &= maxValueLastBlock_;
-	} else {
-		for (i = number.size_;i < size_ - 1; ++i) {
-			blocks_[i] |= setterCarryBit;
-			blocks_[i] -= carryBit;
-			carryBit = !(blocks_[i] >> BLOCK_BITS);
-			blocks_[i] &= BLOCK_MAX_NUMBER;
-			assert((carryBit & 1) == carryBit);
-		}
-		// last block bigger number
-		blocks_[i] = blocks_[i] - carryBit;
-		blocks_[i] &= maxValueLastBlock_;
+	for (; i < size_; ++i) {
+		blocks_[i] = subBorrow(blocks_[i], 0, borrow);
 	}
+	blocks_[size_ - 1] &= maxValueLastBlock_;
 }
 
-void BigInt::mulByBit(int bitValue)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::mulByBit(int bitValue)
 {
 	assert((bitValue & 1) == bitValue);
 
@@ -610,61 +1103,103 @@ void BigInt::mulByBit(int bitValue)
 	}
 }
 
-bool BigInt::div(const BigInt &y, BigInt &q, BigInt &r) const
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::div(const FixedBigInt &y, FixedBigInt &q, FixedBigInt &r) const
 {
 	if (y.isZero()) {
 		CRITICAL("Could not divide by zero.");
 		return false;
 	}
-	int res;
-	for (int i = length_ - 1; i >= 0; --i) {
-		r.shiftLeftBlock(1);
-		r.setBit(0, getBit(i));
-		res = r.cmp(y);
-		if (res == 1 || res == 0) {
-			r.sub(y);
-			q.setBit(i, 1);
-		}
+	q.setZero();
+	r.setZero();
+	if (cmp(y) == -1) {
+		r.copyContent(*this);
+		return true;
+	}
+
+	// amount of significant blocks of dividend and divisor
+	const unsigned int len = getPosMostSignificatnBit() / BLOCK_BITS + 1;
+	const unsigned int n = y.getPosMostSignificatnBit() / BLOCK_BITS + 1;
+
+	if (n == 1) {
+		r.blocks_[0] = divmodWord(y.blocks_[0], q);
+		return true;
 	}
+
+	block u[size_ + 1];
+	block v[size_];
+	// normalize divisor, so its most significant bit is set
+	const unsigned int shift = BLOCK_BITS - 1 - blockMostSignificantBit(y.blocks_[n - 1]);
+
+	shiftBlocksLeft(v, y.blocks_.data(), n, shift);
+	u[len] = shiftBlocksLeft(u, blocks_.data(), len, shift);
+	divBlocks(u, len + 1, v, n, q.blocks_.data());
+	shiftBlocksRight(r.blocks_.data(), u, n, shift);
 	return true;
 }
 
-void BigInt::mulHalfNumbers(const BigInt &y, BigInt &res) const
+template <unsigned int Bits>
+block FixedBigInt<Bits>::divmodWord(block d, FixedBigInt &q) const
 {
-	assert(getPosMostSignificatnBit() <= (int)length_ / 2);
-	assert(y.getPosMostSignificatnBit() <= (int)length_ / 2);
+	assert(d != 0 && d <= BLOCK_MAX_NUMBER);
 
-	res.setZero();
-	// half number contains 17 full blocks and 1 block with 2 bits
-	int sizeHalf = size_ / 2;
-	assert(sizeHalf == 17);
+	block rem = 0;
+	int i;
 
-	block u = 0;
-	block v = 0;
-	block c = 0;
-	int64_t product = 0;
+	// q could be the same number as this
+	for (i = size_ - 1; i >= 0; --i) {
+		q.blocks_[i] = divWord(rem, blocks_[i], d, rem);
+	}
+	return rem;
+}
 
-	for (int i = 0; i <= sizeHalf; ++i) {
-		c = 0;
-		for (int j = 0; j <= sizeHalf; ++j) {
-			product = res.blocks_[i + j] + (int64_t)blocks_[i] * y.blocks_[j] + c;
-			v = product & BLOCK_MAX_NUMBER;
-			u = (product >> BLOCK_BITS) & BLOCK_MAX_NUMBER;
-			assert(u <= BLOCK_MAX_NUMBER);
-			res.blocks_[i + j] = v;
-			c = u;
-		}
-		if (i != sizeHalf) {
-			res.blocks_[i + sizeHalf + 1] = u;
-		}
+template <unsigned int Bits>
+block FixedBigInt<Bits>::modWord(block d) const
+{
+	assert(d != 0 && d <= BLOCK_MAX_NUMBER);
+
+	block rem = 0;
+	int i;
+
+	for (i = size_ - 1; i >= 0 && blocks_[i] == 0; --i) {
+	}
+	for (; i >= 0; --i) {
+		divWord(rem, blocks_[i], d, rem);
+	}
+	return rem;
+}
+
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::mul(const FixedBigInt &y, FixedBigInt<B> &res) const
+{
+	block product[2 * size_];
+	block scratch[KARATSUBA_SCRATCH(size_)];
+
+	// amount of significant blocks of the biggest number
+	unsigned int n = std::max(getPosMostSignificatnBit(), y.getPosMostSignificatnBit())
+			 / BLOCK_BITS + 1;
+	unsigned int i;
+
+	assert(n <= size_);
+
+	mulKaratsuba(blocks_.data(), y.blocks_.data(), n, product, scratch);
+
+	// product should fit to res
+	for (i = res.size_; i < 2 * n; ++i) {
+		assert(product[i] == 0);
 	}
+	res.setZero();
+	std::copy(product, product + std::min(2 * n, res.size_), res.blocks_.data());
+	assert(res.blocks_[res.size_ - 1] <= res.maxValueLastBlock_);
 }
 
-void BigInt::mulMont(const BigInt &y, const BigInt &m, BigInt &ret) const
+template <unsigned int Bits>
+void FixedBigInt<Bits>::mulMont(const FixedBigInt &y, const FixedBigInt &m, FixedBigInt &ret) const
 {
 	assert(length_ == y.length_);
 	assert(length_ == m.length_);
-	assert(m.preComputedTable_);
+	assert(m.context_);
 
 	assert(cmp(m) == -1);
 	assert(y.cmp(m) == -1);
@@ -675,8 +1210,8 @@ void BigInt::mulMont(const BigInt &y, const BigInt &m, BigInt &ret) const
 	//assert(m.getBit(0) == 1);
 
 	// this - x
-	BigInt resultSmall;
-	BigInt resultDouble(BIGINT_DOUBLE_BITS);
+	FixedBigInt resultSmall;
+	Double resultDouble;
 	block hight = 0;
 
 	unsigned int u = 0;
@@ -685,7 +1220,7 @@ void BigInt::mulMont(const BigInt &y, const BigInt &m, BigInt &ret) const
 	unsigned int i;
 
 	// fing max len of numbers
-	unsigned int len = m.posMostSignBit_;
+	unsigned int len = m.context_->posMostSignBit_;
 
 	for (i = 0; i <= len; ++i) {
 		xi = this->getBit(i);
@@ -718,62 +1253,380 @@ void BigInt::mulMont(const BigInt &y, const BigInt &m, BigInt &ret) const
 		resultDouble.sub(m);
 	}
 	resultDouble.shiftLeft(len + 1);
-	resultDouble.mod(m);
+	resultDouble.mod(*m.context_);
 	ret.copyContent(resultDouble);
 }
 
-void BigInt::initModularReduction()
+/**
+ * @brief 			Word-level Montgomery multiplication (CIOS).
+ * @param ctx			- INPUT. Context of module m.
+ * @param x, y			- INPUT. Blocks of numbers less than m.
+ * @param t			[output] Array of montSize_ + 2 blocks.
+ * 				First montSize_ blocks will contain
+ * 				x * y * R^(-1) mod m.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::montRedcCIOS(const ModContext &ctx, const block *x, const block *y,
+				     block *t)
 {
-	assert(isZero() == false);
-	assert(preComputedTable_ == NULL && posMostSignBit_ == -1);
-
-	posMostSignBit_ = getPosMostSignificatnBit();
-	const int len = posMostSignBit_ + 2;
-	preComputedTable_ = new BigInt*[len];
-	int i;
-
-	preComputedTable_[0] = new BigInt(BIGINT_DOUBLE_BITS);
-	preComputedTable_[0]->setNumber(1);
-	preComputedTable_[0]->shiftLeft(posMostSignBit_);
-
-	while(preComputedTable_[0]->cmp(*this) == 1) {
-		preComputedTable_[0]->sub(*this);
-	}
-
-
-	for (i = 1; i < len; ++i) {
-		preComputedTable_[i] = preComputedTable_[i - 1]->copy();
-		preComputedTable_[i]->shiftLeft(1);
-		while(preComputedTable_[i]->cmp(*this) == 1) {
-			preComputedTable_[i]->sub(*this);
+	const unsigned int s = ctx.montSize_;
+	const block *m = ctx.module_.blocks_.data();
+	dblock sum;
+	block carry, u;
+	unsigned int i, j;
+
+	memset(t, 0, (s + 2) * sizeof(block));
+
+	for (i = 0; i < s; ++i) {
+		// t = t + x * y[i]
+		carry = 0;
+		for (j = 0; j < s; ++j) {
+			sum = (dblock)x[j] * y[i] + t[j] + carry;
+			t[j] = (block)sum & BLOCK_MAX_NUMBER;
+			carry = (block)(sum >> BLOCK_BITS);
+		}
+		t[s] = addCarry(t[s], carry, t[s + 1]);
+
+		// t = (t + u * m) / 2^BLOCK_BITS
+		u = (t[0] * ctx.montInv_) & BLOCK_MAX_NUMBER;
+		sum = (dblock)u * m[0] + t[0];
+		carry = (block)(sum >> BLOCK_BITS);
+		for (j = 1; j < s; ++j) {
+			sum = (dblock)u * m[j] + t[j] + carry;
+			t[j - 1] = (block)sum & BLOCK_MAX_NUMBER;
+			carry = (block)(sum >> BLOCK_BITS);
 		}
+		u = 0;
+		t[s - 1] = addCarry(t[s], carry, u);
+		t[s] = t[s + 1] + u;
+		t[s + 1] = 0;
+	}
 
+	// t < 2m, so one subtraction is enough
+	int diff = t[s] ? 1 : 0;
+	for (j = s; j > 0 && diff == 0; --j) {
+		diff = t[j - 1] > m[j - 1] ? 1 : t[j - 1] < m[j - 1] ? -1 : 0;
+	}
+	if (diff != -1) {
+		subBlocks(t, s + 1, m, s);
 	}
-	DEBUG("Init of montgomery multiplication done.");
 }
 
-void BigInt::shutDownModularReduction()
+template <unsigned int Bits>
+void FixedBigInt<Bits>::mulMontCIOS(const FixedBigInt &y, const FixedBigInt &m, FixedBigInt &ret) const
 {
-	assert(preComputedTable_ && posMostSignBit_ > -1);
-	const int len = posMostSignBit_ + 2;
-	int i;
-	for (i = 0; i < len; ++i) {
-		delete preComputedTable_[i];
-	}
-	delete[] preComputedTable_;
-	preComputedTable_ = NULL;
-	posMostSignBit_ = -1;
-	DEBUG("Shut down of montgomery multiplication done.");
+	assert(m.context_);
+
+	mulMontCIOS(y, *m.context_, ret);
 }
 
-void BigInt::mod(const BigInt &m)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::mulMontCIOS(const FixedBigInt &y, const ModContext &ctx, FixedBigInt &ret) const
 {
-	assert(m.preComputedTable_);
-	assert(m.posMostSignBit_ != -1);
+	assert(cmp(ctx.module_) == -1);
+	assert(y.cmp(ctx.module_) == -1);
 
-	BigInt r(BIGINT_DOUBLE_BITS);
-	const int k = m.posMostSignBit_;
-	int posMostSignBitZ = getPosMostSignificatnBit();
+	const unsigned int s = ctx.montSize_;
+	block t[size_ + 2];
+
+	assert(s <= size_);
+
+	// t = x * y * R^(-1) mod m
+	montRedcCIOS(ctx, blocks_.data(), y.blocks_.data(), t);
+	ret.setZero();
+	std::copy(t, t + s, ret.blocks_.data());
+
+	// ret = (x * y * R^(-1)) * R^2 * R^(-1) mod m = x * y mod m
+	montRedcCIOS(ctx, ret.blocks_.data(), ctx.montR2_.blocks_.data(), t);
+	std::copy(t, t + s, ret.blocks_.data());
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::montMul(const FixedBigInt &y, const ModContext &ctx, FixedBigInt &ret) const
+{
+	assert(cmp(ctx.module_) == -1);
+	assert(y.cmp(ctx.module_) == -1);
+
+	block t[size_ + 2];
+
+	montRedcCIOS(ctx, blocks_.data(), y.blocks_.data(), t);
+	ret.setZero();
+	std::copy(t, t + ctx.montSize_, ret.blocks_.data());
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::montSqr(const ModContext &ctx, FixedBigInt &ret) const
+{
+	assert(cmp(ctx.module_) == -1);
+
+	const unsigned int s = ctx.montSize_;
+	block r[2 * size_ + 1];
+
+	sqrSchoolbook(blocks_.data(), s, r);
+	r[2 * s] = 0;
+	montRedcBlocks(ctx, r, ret);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::sqrMod(const ModContext &ctx, FixedBigInt &ret) const
+{
+	// (x^2 * R^(-1)) * R^2 * R^(-1) = x^2 mod m
+	montSqr(ctx, ret);
+	ret.montMul(ctx.montR2_, ctx, ret);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::toMont(const ModContext &ctx, FixedBigInt &ret) const
+{
+	// x * R^2 * R^(-1) = x * R mod m
+	montMul(ctx.montR2_, ctx, ret);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::fromMont(const ModContext &ctx, FixedBigInt &ret) const
+{
+	assert(cmp(ctx.module_) == -1);
+
+	block one[size_] = {1};
+	block t[size_ + 2];
+
+	montRedcCIOS(ctx, blocks_.data(), one, t);
+	ret.setZero();
+	std::copy(t, t + ctx.montSize_, ret.blocks_.data());
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::montRedc(const Double &t, const ModContext &ctx, FixedBigInt &ret)
+{
+	const unsigned int s = ctx.montSize_;
+	block r[2 * size_ + 1];
+
+	memset(r, 0, sizeof(r));
+	std::copy(t.blocks_.data(), t.blocks_.data() + std::min(2 * s, t.size_), r);
+	montRedcBlocks(ctx, r, ret);
+}
+
+/**
+ * @brief 			Montgomery reduction of array of blocks.
+ * @param r			- INPUT. Array of 2 * montSize_ + 1 blocks with
+ * 				number less than m * R, the last block is zero.
+ * 				Array is used as temporary.
+ * @param ret			[output] r * R^(-1) mod m.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::montRedcBlocks(const ModContext &ctx, block *r, FixedBigInt &ret)
+{
+	const unsigned int s = ctx.montSize_;
+	const block *m = ctx.module_.blocks_.data();
+	const block montInv = ctx.montInv_;
+	block carry, u, top = 0;
+	dblock sum;
+	unsigned int i, j;
+
+	for (i = 0; i < s; ++i) {
+		// r = r + u * m * 2^(i * BLOCK_BITS), lower block becomes zero
+		u = (r[i] * montInv) & BLOCK_MAX_NUMBER;
+		carry = 0;
+		for (j = 0; j < s; ++j) {
+			sum = (dblock)u * m[j] + r[i + j] + carry;
+			r[i + j] = (block)sum & BLOCK_MAX_NUMBER;
+			carry = (block)(sum >> BLOCK_BITS);
+		}
+		// carry out of the upper block is kept for the next row
+		sum = (dblock)r[i + s] + carry + top;
+		r[i + s] = (block)sum & BLOCK_MAX_NUMBER;
+		top = (block)(sum >> BLOCK_BITS);
+	}
+	r[2 * s] += top;
+
+	// r / R < 2m, so one subtraction is enough
+	int diff = r[2 * s] ? 1 : 0;
+	for (j = s; j > 0 && diff == 0; --j) {
+		diff = r[s + j - 1] > m[j - 1] ? 1 : r[s + j - 1] < m[j - 1] ? -1 : 0;
+	}
+	if (diff != -1) {
+		subBlocks(r + s, s + 1, m, s);
+	}
+	ret.setZero();
+	std::copy(r + s, r + 2 * s, ret.blocks_.data());
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::initModularReduction()
+{
+	assert(context_ == NULL);
+
+	ownContext_ = ModContext::create(*this);
+	context_ = ownContext_.get();
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::initModularReduction(Workspace &ws)
+{
+	assert(context_ == NULL);
+
+	ws.context_.init(*this);
+	context_ = &ws.context_;
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::shutDownModularReduction()
+{
+	assert(context_);
+
+	context_ = NULL;
+	ownContext_.reset();
+}
+
+template <unsigned int Bits>
+BigIntModContext<Bits>::BigIntModContext()
+	: posMostSignBit_(-1), montInv_(0), montSize_(0), kernel_(NULL), digitsInv_(0)
+{
+}
+
+template <unsigned int Bits>
+BigIntModContext<Bits>::BigIntModContext(const FixedBigInt<Bits> &m) : BigIntModContext()
+{
+	init(m);
+}
+
+template <unsigned int Bits>
+std::shared_ptr<const BigIntModContext<Bits>> BigIntModContext<Bits>::create(const FixedBigInt<Bits> &m)
+{
+	return std::make_shared<const BigIntModContext>(m);
+}
+
+template <unsigned int Bits>
+const FixedBigInt<Bits>& BigIntModContext<Bits>::getModule() const
+{
+	return module_;
+}
+
+/**
+ * @brief 			Fill pre-computed table for modular reduction
+ * 				and parameters of Montgomery multiplication.
+ * 				Memory of table is reused by next call.
+ * @param m			- INPUT. Module, should be odd.
+ */
+template <unsigned int Bits>
+void BigIntModContext<Bits>::init(const FixedBigInt<Bits> &m)
+{
+	assert(m.isZero() == false);
+
+	module_.copyContent(m);
+	posMostSignBit_ = m.getPosMostSignificatnBit();
+	const int len = posMostSignBit_ + 2;
+	int i;
+
+	table_.resize(len);
+	table_[0].setNumber(1);
+	table_[0].shiftLeft(posMostSignBit_);
+
+	while(table_[0].cmp(m) != -1) {
+		table_[0].sub(m);
+	}
+
+
+	for (i = 1; i < len; ++i) {
+		table_[i].copyContent(table_[i - 1]);
+		table_[i].shiftLeft(1);
+		while(table_[i].cmp(m) != -1) {
+			table_[i].sub(m);
+		}
+
+	}
+
+	// -m^(-1) mod 2^BLOCK_BITS by Newton iteration, m should be odd
+	block inv = m.blocks_[0];
+	for (i = 0; i < 6; ++i) {
+		inv *= 2 - m.blocks_[0] * inv;
+	}
+	montInv_ = (0 - inv) & BLOCK_MAX_NUMBER;
+	montSize_ = posMostSignBit_ / BLOCK_BITS + 1;
+
+	kernel_ = (m.blocks_[0] & 1) ? getMontKernel52(posMostSignBit_ + 1) : NULL;
+	if (kernel_) {
+		const unsigned int stride = MONT52_STRIDE(kernel_->digits);
+		digitsModule_.resize(stride);
+		m.toDigits(digitsModule_.data(), stride, MONT52_DIGIT_BITS);
+		uint64_t inv52 = digitsModule_[0];
+		for (i = 0; i < 6; ++i) {
+			inv52 *= 2 - digitsModule_[0] * inv52;
+		}
+		digitsInv_ = (0 - inv52) & MONT52_DIGIT_MASK;
+	}
+
+	// R^2 mod m for both radixes, start from 2^(2k + 1) mod m
+	const int r2Bits = 2 * BLOCK_BITS * montSize_;
+	const int digitsR2Bits = kernel_ ? 2 * MONT52_DIGIT_BITS * kernel_->digits : 0;
+	typename FixedBigInt<Bits>::Double r2(table_[len - 1]);
+	FixedBigInt<Bits> digitsR2;
+	for (i = 2 * posMostSignBit_ + 1; i < std::max(r2Bits, digitsR2Bits); ++i) {
+		r2.shiftLeftBlock(1);
+		if (r2.cmp(m) != -1) {
+			r2.sub(m);
+		}
+		if (i + 1 == r2Bits) {
+			montR2_.setZero();
+			montR2_.copyContent(r2);
+		}
+		if (i + 1 == digitsR2Bits) {
+			digitsR2.copyContent(r2);
+			digitsR2_.resize(MONT52_STRIDE(kernel_->digits));
+			digitsR2.toDigits(digitsR2_.data(), digitsR2_.size(), MONT52_DIGIT_BITS);
+		}
+	}
+	DEBUG("Init of montgomery multiplication done.");
+}
+
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::mod(const FixedBigInt<B> &m)
+{
+	assert(m.context_);
+
+	mod(*m.context_);
+}
+
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::mod(const FixedBigInt<B> &m, BigIntWorkspace<B> &ws)
+{
+	assert(m.context_);
+
+	modWithTemp(*m.context_, ws.double_);
+}
+
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::mod(const BigIntModContext<B> &ctx)
+{
+	typename FixedBigInt<B>::Double r;
+	modWithTemp(ctx, r);
+}
+
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::mod(const BigIntModContext<B> &ctx, BigIntWorkspace<B> &ws)
+{
+	modWithTemp(ctx, ws.double_);
+}
+
+/**
+ * @brief 			Modular reduction by pre-computed table.
+ * @param ctx			- INPUT. Context of module.
+ * @param r			- Temporary number.
+ */
+template <unsigned int Bits>
+template <unsigned int B>
+void FixedBigInt<Bits>::modWithTemp(const BigIntModContext<B> &ctx,
+				    typename FixedBigInt<B>::Double &r)
+{
+	static_assert(Bits <= 2 * B, "Module is too short for the number");
+
+	const FixedBigInt<B> &m = ctx.module_;
+	const int k = ctx.posMostSignBit_;
+	int posMostSignBitZ = getPosMostSignificatnBit();
 
 	assert(posMostSignBitZ - k <= k + 1);
 
@@ -785,132 +1638,579 @@ void BigInt::mod(const BigInt &m)
 		return;
 	}
 	int i;
+	r.setZero();
 	for (i = posMostSignBitZ; i >= k; --i) {
 		if (clearBit(i)) {
-			r.add(*(m.preComputedTable_[i - k]));
+			r.add(ctx.table_[i - k]);
 		}
 	}
 	r.add(*this);
 
-	while (r.cmp(m) == 1) {
+	while (r.cmp(m) != -1) {
 		r.sub(m);
 	}
 	copyContent(r);
 }
 
-void BigInt::splitToRWords(std::vector<block> &rWords, int lenBits) const
+/**
+ * @brief 			Size of window for sliding-window exponentiation.
+ * @param bits			- INPUT. Length of exponent.
+ */
+static unsigned int expWindowSize(int bits)
 {
-	assert(lenBits > 0 && lenBits <= WORD_BITS);
-	int len = length_ / WORD_BITS;
-	std::vector<block> rawArray(len);
-	blocksToRawArray(rawArray);
+	return bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1;
+}
 
-	int bitValue;
-	int posBlock;
-	block rWord = 0;
-	int rWordBitPos = (length_ % lenBits) - 1;
-	int leftBits;
-
-	for (posBlock = len - 1; posBlock >= 0; --posBlock) {
-		for (leftBits = WORD_BITS - 1; leftBits >= 0; --leftBits) {
-			bitValue = (rawArray[posBlock] >> leftBits) & 1;
-			// set bit to rWord
-			rWord ^= (-bitValue ^ rWord) & (1 << rWordBitPos);
-			if (rWordBitPos != 0) {
-				// move to other bit position
-				--rWordBitPos;
-			} else {
-				// push rWord to vector and clear data
-				rWordBitPos = lenBits - 1;
-				assert(rWord <= fillBits(lenBits));
-				rWords.push_back(rWord);
-				rWord = 0;
-			}
+template <unsigned int Bits>
+BigIntExponent<Bits>::BigIntExponent() : window_(1)
+{
+}
+
+template <unsigned int Bits>
+BigIntExponent<Bits>::BigIntExponent(const FixedBigInt<Bits> &e) : BigIntExponent()
+{
+	recode(e);
+}
+
+template <unsigned int Bits>
+unsigned int BigIntExponent<Bits>::getWindow() const
+{
+	return window_;
+}
+
+template <unsigned int Bits>
+void BigIntExponent<Bits>::recode(const FixedBigInt<Bits> &e)
+{
+	const int posMostSignBit = e.getPosMostSignificatnBit();
+	int i, j;
+	unsigned int squares = 0;
+	Step step;
+
+	steps_.clear();
+	window_ = expWindowSize(posMostSignBit + 1);
+
+	// scan from most significant bit, window always ends by one
+	for (i = posMostSignBit; i >= 0; ) {
+		if (e.getBit(i) == 0) {
+			++squares;
+			--i;
+			continue;
+		}
+		j = std::max(i - (int)window_ + 1, 0);
+		while (e.getBit(j) == 0) {
+			++j;
+		}
+		step.digit = 0;
+		for (int bit = i; bit >= j; --bit) {
+			step.digit = (step.digit << 1) | e.getBit(bit);
 		}
+		step.squares = steps_.empty() ? 0 : squares + i - j + 1;
+		steps_.push_back(step);
+		squares = 0;
+		i = j - 1;
 	}
-	if (rWordBitPos != lenBits - 1) {
-		rWord >>= rWordBitPos + 1;
-		rWords.push_back(rWord);
+	if (squares) {
+		step.squares = squares;
+		step.digit = 0;
+		steps_.push_back(step);
 	}
-	std::reverse(rWords.begin(), rWords.end());
 }
 
-void BigInt::exp(const BigInt &e, const BigInt &m, BigInt &ret) const
+template <unsigned int Bits>
+void FixedBigInt<Bits>::exp(const FixedBigInt &e, const FixedBigInt &m, FixedBigInt &ret) const
 {
-	BigInt C;
-	std::vector<block> rWords;
-	int i, j;
-	int size;
-	///
-	/// k = 5 => b = 2^k = 32
-	///
-	const int k = 5;
-	const int b = 32;
-	BigInt precompValues[b];
+	assert(m.context_);
+
+	Workspace ws;
+	exp(e, *m.context_, ret, ws);
+}
 
-	/* check x less that mod */
-	//this->mod(m);
+template <unsigned int Bits>
+void FixedBigInt<Bits>::exp(const FixedBigInt &e, const FixedBigInt &m, FixedBigInt &ret,
+			    Workspace &ws) const
+{
+	assert(m.context_);
 
-	precompValues[0].setNumber(1);
-	precompValues[1].copyContent(*this);
+	exp(e, *m.context_, ret, ws);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::exp(const FixedBigInt &e, const ModContext &ctx, FixedBigInt &ret) const
+{
+	Workspace ws;
+	exp(e, ctx, ret, ws);
+}
 
-	// precompValues[1] is x
-	precompValues[1].mod(m);
+template <unsigned int Bits>
+void FixedBigInt<Bits>::exp(const FixedBigInt &e, const ModContext &ctx, FixedBigInt &ret,
+			    Workspace &ws) const
+{
+	ws.exponent_.recode(e);
+	exp(ws.exponent_, ctx, ret, ws);
+}
 
-	for (i = 2; i < b; ++i) {
-		precompValues[1].mulMont(precompValues[i - 1], m, precompValues[i]);
+template <unsigned int Bits>
+void FixedBigInt<Bits>::exp(const Exponent &e, const ModContext &ctx, FixedBigInt &ret) const
+{
+	Workspace ws;
+	exp(e, ctx, ret, ws);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::exp(const Exponent &e, const ModContext &ctx, FixedBigInt &ret,
+			    Workspace &ws) const
+{
+	if (ctx.kernel_) {
+		expKernel(e, ctx, ret, ws);
+		return;
 	}
+	expMont(e, ctx, ret, ws);
+	ret.fromMont(ctx, ret);
+}
 
-	e.splitToRWords(rWords, k);
-	size = rWords.size();
+/**
+ * @brief 			Sliding-window exponentiation in Montgomery form.
+ * @param e			- INPUT. Recoded exponent.
+ * @param ret			[output] Montgomery form of this^e mod m.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::expMont(const Exponent &e, const ModContext &ctx, FixedBigInt &ret,
+				Workspace &ws) const
+{
+	FixedBigInt C;
+	// powers[i] is Montgomery form of x^(2i + 1)
+	FixedBigInt *powers = ws.powers_;
+	const unsigned int count = 1 << (e.window_ - 1);
+	unsigned int i, j;
+
+	if (e.steps_.empty()) {
+		// x^0 = 1
+		C.setNumber(1);
+		C.toMont(ctx, ret);
+		return;
+	}
 
-	C.copyContent(precompValues[rWords[size - 1]]);
+	powers[0].copyContent(*this);
+	powers[0].mod(ctx, ws);
+	powers[0].toMont(ctx, powers[0]);
+	if (count > 1) {
+		powers[0].montSqr(ctx, C);
+		for (i = 1; i < count; ++i) {
+			powers[i - 1].montMul(C, ctx, powers[i]);
+		}
+	}
 
-	for (i = size - 2; i >= 0; --i) {
-		for (j = 0; j < k; ++j) {
-			C.mulMont(C, m, C);
+	C.copyContent(powers[e.steps_[0].digit >> 1]);
+	for (i = 1; i < e.steps_.size(); ++i) {
+		for (j = 0; j < e.steps_[i].squares; ++j) {
+			C.montSqr(ctx, C);
 		}
-		if (rWords[i]) {
-			C.mulMont(precompValues[rWords[i]], m, C);
+		if (e.steps_[i].digit) {
+			C.montMul(powers[e.steps_[i].digit >> 1], ctx, C);
 		}
 	}
 	ret.copyContent(C);
 }
 
-void BigInt::generateRand(RandomGenerator &gen, int size)
+/**
+ * @brief 			Sliding-window exponentiation by vectorized
+ * 				kernel of context in radix 2^52.
+ * @param e			- INPUT. Recoded exponent.
+ * @param ret			[output] this^e mod m.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::expKernel(const Exponent &e, const ModContext &ctx, FixedBigInt &ret,
+				  Workspace &ws) const
 {
-	assert(size <= BIGINT_BITS);
+	const MontKernel52 &kernel = *ctx.kernel_;
+	const unsigned int stride = MONT52_STRIDE(kernel.digits);
+	const unsigned int count = 1 << (e.window_ - 1);
+	const uint64_t *m = ctx.digitsModule_.data();
+	const uint64_t k0 = ctx.digitsInv_;
+	std::vector<uint64_t> &digits = ws.digits_;
+	FixedBigInt x;
+	unsigned int i, j;
+
+	if (e.steps_.empty()) {
+		// x^0 = 1
+		ret.setNumber(1);
+		ret.mod(ctx, ws);
+		return;
+	}
+
+	digits.assign((count + 2) * stride, 0);
+	uint64_t *C = digits.data();
+	uint64_t *one = C + stride;
+	// powers + i * stride is Montgomery form of x^(2i + 1)
+	uint64_t *powers = one + stride;
+
+	one[0] = 1;
+	x.copyContent(*this);
+	x.mod(ctx, ws);
+	x.toDigits(powers, stride, MONT52_DIGIT_BITS);
+	kernel.mul(powers, powers, ctx.digitsR2_.data(), m, k0);
+	if (count > 1) {
+		kernel.sqr(C, powers, powers, m, k0);
+		for (i = 1; i < count; ++i) {
+			kernel.mul(powers + i * stride, powers + (i - 1) * stride, C, m, k0);
+		}
+	}
+
+	std::copy(powers + (e.steps_[0].digit >> 1) * stride,
+		  powers + (e.steps_[0].digit >> 1) * stride + stride, C);
+	for (i = 1; i < e.steps_.size(); ++i) {
+		for (j = 0; j < e.steps_[i].squares; ++j) {
+			kernel.sqr(C, C, C, m, k0);
+		}
+		if (e.steps_[i].digit) {
+			kernel.mul(C, C, powers + (e.steps_[i].digit >> 1) * stride, m, k0);
+		}
+	}
+	// C * 1 * R^(-1) is out of Montgomery form
+	kernel.mul(C, C, one, m, k0);
+	ret.fromDigits(C, kernel.digits, MONT52_DIGIT_BITS);
+}
+
+/**
+ * @brief 			Convert number to digits of digitBits bits.
+ * @param digits		[output] Array of count digits.
+ * @param digitBits		- INPUT. Not more than 63.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::toDigits(uint64_t *digits, unsigned int count,
+				 unsigned int digitBits) const
+{
+	unsigned int i, got, take, pos;
+	uint64_t digit;
+
+	assert(digitBits < 64);
+
+	for (i = 0; i < count; ++i) {
+		digit = 0;
+		for (got = 0; got < digitBits; got += take) {
+			pos = i * digitBits + got;
+			if (pos / BLOCK_BITS >= size_) {
+				break;
+			}
+			take = std::min(BLOCK_BITS - pos % BLOCK_BITS, digitBits - got);
+			digit |= ((uint64_t)(blocks_[pos / BLOCK_BITS] >> (pos % BLOCK_BITS)) &
+				  ((UINT64_C(1) << take) - 1)) << got;
+		}
+		digits[i] = digit;
+	}
+}
+
+/**
+ * @brief 			Set number from digits of digitBits bits.
+ * @param digits		- INPUT. Array of count digits.
+ * @param digitBits		- INPUT. Not more than 63.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::fromDigits(const uint64_t *digits, unsigned int count,
+				   unsigned int digitBits)
+{
+	unsigned int i, put, take, pos;
+
+	assert(digitBits < 64);
+
+	setZero();
+	for (i = 0; i < count; ++i) {
+		for (put = 0; put < digitBits; put += take) {
+			pos = i * digitBits + put;
+			if (pos / BLOCK_BITS >= size_) {
+				assert((digits[i] >> put) == 0);
+				break;
+			}
+			take = std::min(BLOCK_BITS - pos % BLOCK_BITS, digitBits - put);
+			blocks_[pos / BLOCK_BITS] |= (block)((digits[i] >> put) &
+							     ((UINT64_C(1) << take) - 1))
+						     << (pos % BLOCK_BITS);
+		}
+	}
+}
+
+template <unsigned int Bits>
+BigIntFixedBaseExp<Bits>::BigIntFixedBaseExp(const FixedBigInt<Bits> &base,
+					     const BigIntModContext<Bits> &ctx,
+					     unsigned int maxExpBits, unsigned int teeth)
+	: context_(ctx), base_(base), teeth_(teeth),
+	  columns_((maxExpBits + teeth - 1) / teeth), table_(1u << teeth)
+{
+	assert(teeth > 0 && teeth <= 16);
+	assert(maxExpBits > 0 && maxExpBits <= Bits);
+
+	FixedBigInt<Bits> rowBase, one;
+	unsigned int row, i, j;
+
+	base_.mod(ctx);
+	one.setNumber(1);
+	one.toMont(ctx, table_[0]);
+	base_.toMont(ctx, rowBase);
+	for (row = 0; row < teeth_; ++row) {
+		if (row) {
+			for (j = 0; j < columns_; ++j) {
+				rowBase.montSqr(ctx, rowBase);
+			}
+		}
+		// table_[i] for i with most significant bit row
+		for (i = 1u << row; i < 2u << row; ++i) {
+			table_[i ^ (1u << row)].montMul(rowBase, ctx, table_[i]);
+		}
+	}
+}
+
+template <unsigned int Bits>
+unsigned int BigIntFixedBaseExp<Bits>::getTableSize() const
+{
+	return table_.size();
+}
+
+template <unsigned int Bits>
+void BigIntFixedBaseExp<Bits>::exp(const FixedBigInt<Bits> &e, FixedBigInt<Bits> &ret) const
+{
+	const int posMostSignBit = e.getPosMostSignificatnBit();
+	unsigned int row, column, index, position;
+	FixedBigInt<Bits> C;
+
+	if (posMostSignBit >= (int)(teeth_ * columns_)) {
+		WARN("Exponent is too long for table of fixed base.");
+		base_.exp(e, context_, ret);
+		return;
+	}
+
+	C.copyContent(table_[0]);
+	for (column = columns_; column-- > 0; ) {
+		if (column != columns_ - 1) {
+			C.montSqr(context_, C);
+		}
+		index = 0;
+		for (row = 0; row < teeth_; ++row) {
+			position = row * columns_ + column;
+			if ((int)position <= posMostSignBit && e.getBit(position)) {
+				index |= 1u << row;
+			}
+		}
+		if (index) {
+			C.montMul(table_[index], context_, C);
+		}
+	}
+	C.fromMont(context_, ret);
+}
+
+template <unsigned int Bits>
+BigIntBatch<Bits>::BigIntBatch(const BigIntModContext<Bits> &ctx, unsigned int count)
+	: context_(ctx), count_(count),
+	  digits_(ctx.getModule().getPosMostSignificatnBit() / MONT52_DIGIT_BITS + 1),
+	  montInv_(0), module_(digits_), montR2_(digits_ * BATCH52_LANES, 0),
+	  one_(digits_ * BATCH52_LANES, 0),
+	  lanes_((count + BATCH52_LANES - 1) / BATCH52_LANES * digits_ * BATCH52_LANES, 0)
+{
+	const FixedBigInt<Bits> &m = ctx.getModule();
+	std::vector<uint64_t> digits(digits_);
+	typename FixedBigInt<Bits>::Double r;
+	FixedBigInt<Bits> r2;
+	unsigned int i, l;
+
+	assert(m.getBit(0) == 1);
+
+	m.toDigits(digits.data(), digits_, MONT52_DIGIT_BITS);
+	module_.assign(digits.begin(), digits.end());
+
+	// -m^(-1) mod 2^52 by Newton iteration
+	uint64_t inv = module_[0];
+	for (i = 0; i < 5; ++i) {
+		inv *= 2 - module_[0] * inv;
+	}
+	montInv_ = (0 - inv) & MONT52_DIGIT_MASK;
+
+	// R^2 mod m
+	r.setBit(MONT52_DIGIT_BITS * digits_, 1);
+	r2 = r % m;
+	r2 = (r2 * r2) % m;
+	r2.toDigits(digits.data(), digits_, MONT52_DIGIT_BITS);
+	for (i = 0; i < digits_; ++i) {
+		for (l = 0; l < BATCH52_LANES; ++l) {
+			montR2_[i * BATCH52_LANES + l] = digits[i];
+		}
+	}
+	for (l = 0; l < BATCH52_LANES; ++l) {
+		one_[l] = 1;
+	}
+}
+
+template <unsigned int Bits>
+unsigned int BigIntBatch<Bits>::size() const
+{
+	return count_;
+}
+
+template <unsigned int Bits>
+void BigIntBatch<Bits>::set(unsigned int lane, const FixedBigInt<Bits> &x)
+{
+	assert(lane < count_);
+
+	std::vector<uint64_t> digits(digits_);
+	FixedBigInt<Bits> y(x);
+	uint64_t *group = lanes_.data() + lane / BATCH52_LANES * digits_ * BATCH52_LANES;
+
+	y.mod(context_);
+	y.toDigits(digits.data(), digits_, MONT52_DIGIT_BITS);
+	for (unsigned int i = 0; i < digits_; ++i) {
+		group[i * BATCH52_LANES + lane % BATCH52_LANES] = digits[i];
+	}
+}
+
+template <unsigned int Bits>
+void BigIntBatch<Bits>::get(unsigned int lane, FixedBigInt<Bits> &x) const
+{
+	assert(lane < count_);
+
+	std::vector<uint64_t> digits(digits_);
+	const uint64_t *group = lanes_.data() + lane / BATCH52_LANES * digits_ * BATCH52_LANES;
+
+	for (unsigned int i = 0; i < digits_; ++i) {
+		digits[i] = group[i * BATCH52_LANES + lane % BATCH52_LANES];
+	}
+	x.fromDigits(digits.data(), digits_, MONT52_DIGIT_BITS);
+}
+
+template <unsigned int Bits>
+void BigIntBatch<Bits>::mulMont(const BigIntBatch &y, BigIntBatch &ret) const
+{
+	assert(&y.context_ == &context_ && &ret.context_ == &context_);
+	assert(y.count_ == count_ && ret.count_ == count_);
+
+	if (!hasMontBatch52()) {
+		// lane by lane, blocks are faster than scalar digits of 52 bits
+		FixedBigInt<Bits> x, z;
+		for (unsigned int lane = 0; lane < count_; ++lane) {
+			get(lane, x);
+			y.get(lane, z);
+			x.mulMontCIOS(z, context_, z);
+			ret.set(lane, z);
+		}
+		return;
+	}
+
+	const unsigned int groupSize = digits_ * BATCH52_LANES;
+	std::vector<uint64_t> scratch(BATCH52_SCRATCH(digits_));
+	unsigned int g;
+
+	for (g = 0; g < lanes_.size(); g += groupSize) {
+		// x * y * R^(-1), then * R^2 * R^(-1)
+		montMulBatch52(ret.lanes_.data() + g, lanes_.data() + g, y.lanes_.data() + g,
+			       module_.data(), montInv_, digits_, scratch.data());
+		montMulBatch52(ret.lanes_.data() + g, ret.lanes_.data() + g, montR2_.data(),
+			       module_.data(), montInv_, digits_, scratch.data());
+	}
+}
+
+template <unsigned int Bits>
+void BigIntBatch<Bits>::exp(const FixedBigInt<Bits> &e, BigIntBatch &ret) const
+{
+	exp(BigIntExponent<Bits>(e), ret);
+}
+
+/**
+ * @brief 			Sliding-window exponentiation of every group
+ * 				of lanes by the same recoded exponent.
+ */
+template <unsigned int Bits>
+void BigIntBatch<Bits>::exp(const BigIntExponent<Bits> &e, BigIntBatch &ret) const
+{
+	assert(&ret.context_ == &context_ && ret.count_ == count_);
+
+	if (!hasMontBatch52()) {
+		// lane by lane, blocks are faster than scalar digits of 52 bits
+		FixedBigInt<Bits> x, z;
+		BigIntWorkspace<Bits> ws;
+		for (unsigned int lane = 0; lane < count_; ++lane) {
+			get(lane, x);
+			x.exp(e, context_, z, ws);
+			ret.set(lane, z);
+		}
+		return;
+	}
+
+	const unsigned int groupSize = digits_ * BATCH52_LANES;
+	const unsigned int count = 1 << (e.window_ - 1);
+	const uint64_t *m = module_.data();
+	std::vector<uint64_t> scratch(BATCH52_SCRATCH(digits_));
+	// Montgomery forms of odd powers x^(2i + 1) and of x^2
+	std::vector<uint64_t> powers((count + 1) * groupSize);
+	uint64_t *square = powers.data() + count * groupSize;
+	uint64_t *C;
+	unsigned int g, i, j;
+
+	for (g = 0; g < lanes_.size(); g += groupSize) {
+		C = ret.lanes_.data() + g;
+		if (e.steps_.empty()) {
+			// x^0 = 1
+			montMulBatch52(C, one_.data(), montR2_.data(), m, montInv_, digits_,
+				       scratch.data());
+		} else {
+			montMulBatch52(powers.data(), lanes_.data() + g, montR2_.data(), m,
+				       montInv_, digits_, scratch.data());
+			if (count > 1) {
+				montMulBatch52(square, powers.data(), powers.data(), m, montInv_,
+					       digits_, scratch.data());
+			}
+			for (i = 1; i < count; ++i) {
+				montMulBatch52(powers.data() + i * groupSize,
+					       powers.data() + (i - 1) * groupSize, square, m,
+					       montInv_, digits_, scratch.data());
+			}
+
+			std::copy(powers.begin() + (e.steps_[0].digit >> 1) * groupSize,
+				  powers.begin() + ((e.steps_[0].digit >> 1) + 1) * groupSize, C);
+			for (i = 1; i < e.steps_.size(); ++i) {
+				for (j = 0; j < e.steps_[i].squares; ++j) {
+					montMulBatch52(C, C, C, m, montInv_, digits_, scratch.data());
+				}
+				if (e.steps_[i].digit) {
+					montMulBatch52(C, C, powers.data() + (e.steps_[i].digit >> 1) * groupSize,
+						       m, montInv_, digits_, scratch.data());
+				}
+			}
+		}
+		// out of Montgomery form
+		montMulBatch52(C, C, one_.data(), m, montInv_, digits_, scratch.data());
+	}
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generateRand(RandomGenerator &gen, int size)
+{
+	assert(size <= (int)length_);
 
 	int fullBlocks = size / WORD_BITS;
 	int maxValueLastBlock = fillBits(size - fullBlocks * WORD_BIT);
-	std::vector<block> randArray(length_ / WORD_BITS);
+	std::vector<uint32_t> randArray(length_ / WORD_BITS);
 
-	for (int i = 0; i < fullBlocks; ++i) {
-		randArray[i] = gen.next32bit();
-	}
+	gen.fill(randArray.data(), fullBlocks);
 	if (maxValueLastBlock) {
 		randArray[fullBlocks] = gen.next32bit() & maxValueLastBlock;
 	}
 	rawArrayToBlocks(randArray);
 }
 
-void BigInt::generateRand(RandomGenerator& gen, std::vector<block> &randArray, int size)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generateRand(RandomGenerator& gen, std::vector<uint32_t> &randArray, int size)
 {
-	assert(size <= BIGINT_BITS);
+	assert(size <= (int)length_);
 
 	int fullBlocks = size / WORD_BITS;
 	int maxValueLastBlock = fillBits(size - fullBlocks * WORD_BIT);
 
-	for (int i = 0; i < fullBlocks; ++i) {
-		randArray[i] = gen.next32bit();
-	}
+	gen.fill(randArray.data(), fullBlocks);
 	if (maxValueLastBlock) {
 		randArray[fullBlocks] = gen.next32bit() & maxValueLastBlock;
 	}
 	rawArrayToBlocks(randArray);
 }
 
-void BigInt::gcd(const BigInt &a, BigInt &res) const
+template <unsigned int Bits>
+void FixedBigInt<Bits>::gcd(const FixedBigInt &a, FixedBigInt &res) const
 {
 	if (isZero()) {
 		res.copyContent(a);
@@ -922,10 +2222,10 @@ void BigInt::gcd(const BigInt &a, BigInt &res) const
 	}
 
 
-	BigInt x;
+	FixedBigInt x;
 	x.copyContent(*this);
 
-	BigInt& y = res;
+	FixedBigInt& y = res;
 	y.copyContent(a);
 
 	int g = 0;
@@ -955,30 +2255,224 @@ void BigInt::gcd(const BigInt &a, BigInt &res) const
 	y.shiftLeft(g);
 }
 
-bool BigInt::isEven() const
+/**
+ * @brief 			Binary extended Euclid. Invariants are
+ * 				x1 * this = u mod m and x2 * this = v mod m,
+ * 				odd u and v are subtracted one from other until
+ * 				they become equal to gcd(this, m).
+ */
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::modInverse(const FixedBigInt &m, FixedBigInt &ret) const
+{
+	assert(m.isEven() == false);
+
+	const unsigned int s = m.getPosMostSignificatnBit() / BLOCK_BITS + 1;
+	const block *mb = m.blocks_.data();
+	block u[size_], v[size_], x1[size_ + 1], x2[size_ + 1];
+	unsigned int len = s;
+	block inv = mb[0];
+	int i;
+
+	// -m^(-1) mod 2^BLOCK_BITS by Newton iteration
+	for (i = 0; i < 6; ++i) {
+		inv *= 2 - mb[0] * inv;
+	}
+	inv = (0 - inv) & BLOCK_MAX_NUMBER;
+
+	if (cmp(m) == -1) {
+		std::copy(blocks_.data(), blocks_.data() + s, u);
+	} else {
+		FixedBigInt q, r;
+		div(m, q, r);
+		std::copy(r.blocks_.data(), r.blocks_.data() + s, u);
+	}
+	for (i = s - 1; i >= 0 && u[i] == 0; --i) {
+	}
+	if (i < 0) {
+		// zero is not invertible
+		return false;
+	}
+	std::copy(mb, mb + s, v);
+	memset(x1, 0, (s + 1) * sizeof(block));
+	memset(x2, 0, (s + 1) * sizeof(block));
+	x1[0] = 1;
+
+	for (;;) {
+		shiftOutZeros(u, len, x1, mb, s, inv);
+		shiftOutZeros(v, len, x2, mb, s, inv);
+		while (len > 1 && u[len - 1] == 0 && v[len - 1] == 0) {
+			--len;
+		}
+		i = cmpBlocks(u, v, len);
+		if (i == 0) {
+			break;
+		}
+		if (i == 1) {
+			subBlocks(u, len, v, len);
+			subModBlocks(x1, x2, mb, s);
+		} else {
+			subBlocks(v, len, u, len);
+			subModBlocks(x2, x1, mb, s);
+		}
+	}
+
+	// u = gcd(this, m)
+	if (len != 1 || u[0] != 1) {
+		return false;
+	}
+	ret.setZero();
+	std::copy(x1, x1 + s, ret.blocks_.data());
+	return true;
+}
+
+/**
+ * @brief 			Binary Jacobi symbol. Odd u and v are subtracted
+ * 				one from other, sign is changed by quadratic
+ * 				reciprocity when they are swapped and by
+ * 				(2 / v) when factors of two are removed from u.
+ */
+template <unsigned int Bits>
+int FixedBigInt<Bits>::jacobi(const FixedBigInt &n) const
+{
+	assert(n.isEven() == false);
+
+	const unsigned int s = n.getPosMostSignificatnBit() / BLOCK_BITS + 1;
+	block a[size_], b[size_];
+	block *u = a, *v = b;
+	unsigned int len = s, k;
+	int t = 1, i;
+
+	if (cmp(n) == -1) {
+		std::copy(blocks_.data(), blocks_.data() + s, u);
+	} else {
+		FixedBigInt q, r;
+		div(n, q, r);
+		std::copy(r.blocks_.data(), r.blocks_.data() + s, u);
+	}
+	for (i = s - 1; i >= 0 && u[i] == 0; --i) {
+	}
+	if (i < 0) {
+		// (0 / 1) = 1, otherwise n divides this number
+		return n.cmp(1) == 0 ? 1 : 0;
+	}
+	std::copy(n.blocks_.data(), n.blocks_.data() + s, v);
+
+	for (;;) {
+		while ((u[0] & 1) == 0) {
+			k = u[0] ? blockTrailingZeros(u[0]) : BLOCK_BITS - 1;
+			k = std::min(k, (unsigned int)BLOCK_BITS - 1);
+			shiftBlocksRight(u, u, len, k);
+			// (2 / v) = -1 for v = 3, 5 mod 8
+			if ((k & 1) && ((v[0] & 7) == 3 || (v[0] & 7) == 5)) {
+				t = -t;
+			}
+		}
+		while (len > 1 && u[len - 1] == 0 && v[len - 1] == 0) {
+			--len;
+		}
+		i = cmpBlocks(u, v, len);
+		if (i == 0) {
+			break;
+		}
+		if (i == -1) {
+			std::swap(u, v);
+			if ((u[0] & 3) == 3 && (v[0] & 3) == 3) {
+				t = -t;
+			}
+		}
+		subBlocks(u, len, v, len);
+	}
+
+	// u = gcd(this, n)
+	return len == 1 && u[0] == 1 ? t : 0;
+}
+
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::isEven() const
 {
 	return !(blocks_[0] & 1);
 }
 
-std::vector<uint8_t> BigInt::getByteArray() const
+template <unsigned int Bits>
+std::vector<uint8_t> FixedBigInt<Bits>::getByteArray() const
 {
 	std::vector<uint8_t> byteArray(length_ / BYTE_BITS);
 	getByteArray(byteArray);
 	return byteArray;
 }
 
-void BigInt::getByteArray(std::vector<uint8_t> &byteArray) const
+template <unsigned int Bits>
+void FixedBigInt<Bits>::getByteArray(std::vector<uint8_t> &byteArray) const
 {
-	unsigned int i = 0;
-	std::vector<block> rawArray(length_ / WORD_BITS);
-
-	byteArray.clear();
+	dblock acquired = 0;
+	unsigned int acquiredBits = 0;
+	unsigned int indexBlocks = 0;
 
-	blocksToRawArray(rawArray);
-	for(i = 0; i < rawArray.size(); ++i) {
-		for (int j = 0; j < 4; ++j) {
-			uint8_t ch = rawArray[i] >> (j * 8) & 0xFF;
-			byteArray.push_back(ch);
+	// bytes from the lowest one, without temporary array of words
+	byteArray.resize(length_ / BYTE_BITS);
+	for (size_t i = 0; i < byteArray.size(); ++i) {
+		while (acquiredBits < BYTE_BITS && indexBlocks < size_) {
+			acquired |= (dblock)blocks_[indexBlocks++] << acquiredBits;
+			acquiredBits += BLOCK_BITS;
 		}
+		byteArray[i] = (uint8_t)acquired;
+		acquired >>= BYTE_BITS;
+		acquiredBits -= std::min(acquiredBits, (unsigned int)BYTE_BITS);
 	}
 }
+
+/*
+ * Explicit instantiations for supported lengths.
+ * Operations between numbers of different lengths are instantiated
+ * for number and its double.
+ */
+#define INSTANTIATE_BIGINT_PAIR(bits, otherBits)					\
+	template bool FixedBigInt<bits>::add(const FixedBigInt<otherBits> &);		\
+	template void FixedBigInt<bits>::sub(const FixedBigInt<otherBits> &);		\
+	template int FixedBigInt<bits>::cmp(const FixedBigInt<otherBits> &) const;	\
+	template void FixedBigInt<bits>::copyContent(const FixedBigInt<otherBits> &);	\
+	template int FixedBigInt<bits>::isEqual(const FixedBigInt<otherBits> &) const;
+
+#define INSTANTIATE_BIGINT(bits)							\
+	template class FixedBigInt<bits>;						\
+	template class BigIntModContext<bits>;						\
+	template class BigIntExponent<bits>;						\
+	template class BigIntFixedBaseExp<bits>;					\
+	template class BigIntBatch<bits>;						\
+	INSTANTIATE_BIGINT_PAIR(bits, bits)						\
+	template void FixedBigInt<bits>::mod(const FixedBigInt<bits> &);		\
+	template void FixedBigInt<bits>::mod(const FixedBigInt<bits> &,			\
+					     BigIntWorkspace<bits> &);			\
+	template void FixedBigInt<bits>::mod(const BigIntModContext<bits> &);		\
+	template void FixedBigInt<bits>::mod(const BigIntModContext<bits> &,		\
+					     BigIntWorkspace<bits> &);			\
+	template void FixedBigInt<bits>::mul(const FixedBigInt<bits> &, FixedBigInt<bits> &) const; \
+	template FixedBigInt<bits> FixedBigInt<bits>::operator%(const FixedBigInt<bits> &) const;
+
+#define INSTANTIATE_BIGINT_DOUBLE(bits)							\
+	INSTANTIATE_BIGINT_PAIR(bits, 2 * bits)						\
+	INSTANTIATE_BIGINT_PAIR(2 * bits, bits)						\
+	template void FixedBigInt<2 * bits>::mod(const FixedBigInt<bits> &);		\
+	template void FixedBigInt<2 * bits>::mod(const FixedBigInt<bits> &,		\
+						 BigIntWorkspace<bits> &);		\
+	template void FixedBigInt<2 * bits>::mod(const BigIntModContext<bits> &);	\
+	template void FixedBigInt<2 * bits>::mod(const BigIntModContext<bits> &,	\
+						 BigIntWorkspace<bits> &);		\
+	template void FixedBigInt<bits>::mul(const FixedBigInt<bits> &, FixedBigInt<2 * bits> &) const; \
+	template FixedBigInt<bits> FixedBigInt<2 * bits>::operator%(const FixedBigInt<bits> &) const;	\
+	template FixedBigInt<bits>::FixedBigInt(const FixedBigInt<2 * bits> &);		\
+	template FixedBigInt<2 * bits>::FixedBigInt(const FixedBigInt<bits> &);
+
+INSTANTIATE_BIGINT(512)
+INSTANTIATE_BIGINT(1024)
+INSTANTIATE_BIGINT(2048)
+INSTANTIATE_BIGINT(3072)
+INSTANTIATE_BIGINT(4096)
+INSTANTIATE_BIGINT(6144)
+INSTANTIATE_BIGINT(8192)
+
+INSTANTIATE_BIGINT_DOUBLE(512)
+INSTANTIATE_BIGINT_DOUBLE(1024)
+INSTANTIATE_BIGINT_DOUBLE(2048)
+INSTANTIATE_BIGINT_DOUBLE(3072)
+INSTANTIATE_BIGINT_DOUBLE(4096)
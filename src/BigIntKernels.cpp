@@ -0,0 +1,398 @@
+#include <atomic>
+#include "BigIntKernels.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BIGINT_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static std::atomic<bool> kernelsEnabled(true);
+
+/**
+ * @brief 			Final step of Montgomery multiplication:
+ * 				r = t mod m, where t < 2m is t[0..digits - 1]
+ * 				plus carry * 2^(52 * digits).
+ * @param t			- INPUT. Normalized 52-bit digits.
+ */
+static void finalSubtract52(uint64_t *r, const uint64_t *t, uint64_t carry,
+			    const uint64_t *m, unsigned int digits)
+{
+	int diff = carry ? 1 : 0;
+	uint64_t borrow = 0, v;
+	unsigned int j;
+
+	for (j = digits; j > 0 && diff == 0; --j) {
+		diff = t[j - 1] > m[j - 1] ? 1 : t[j - 1] < m[j - 1] ? -1 : 0;
+	}
+	for (j = 0; j < digits; ++j) {
+		v = t[j];
+		if (diff != -1) {
+			v = v - m[j] - borrow;
+			borrow = v >> 63;
+			v &= MONT52_DIGIT_MASK;
+		}
+		r[j] = v;
+	}
+}
+
+/**
+ * @brief 			Product of 52-bit numbers: a * b = hi * 2^52 + lo.
+ */
+static inline void mul52(uint64_t a, uint64_t b, uint64_t &lo, uint64_t &hi)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 product = (unsigned __int128)a * b;
+	lo = (uint64_t)product & MONT52_DIGIT_MASK;
+	hi = (uint64_t)(product >> MONT52_DIGIT_BITS);
+#else
+	const uint64_t half = (UINT64_C(1) << 26) - 1;
+	uint64_t mid = (a >> 26) * (b & half) + (a & half) * (b >> 26);
+	uint64_t low = (a & half) * (b & half) + ((mid & half) << 26);
+	lo = low & MONT52_DIGIT_MASK;
+	hi = (a >> 26) * (b >> 26) + (mid >> 26) + (low >> MONT52_DIGIT_BITS);
+#endif
+}
+
+/**
+ * @brief 			Word-level Montgomery multiplication (CIOS)
+ * 				in radix 2^52: r = a * b * 2^(-52 * digits) mod m.
+ * @param r			[output] Array of digits numbers.
+ * @param t			- Temporary array of digits + 2 numbers.
+ */
+static void mulDigits52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			const uint64_t *m, uint64_t k0, unsigned int digits,
+			uint64_t *t)
+{
+	const unsigned int D = digits;
+	uint64_t lo, hi, v, carry, y;
+	unsigned int i, j;
+
+	for (j = 0; j < D + 2; ++j) {
+		t[j] = 0;
+	}
+
+	for (i = 0; i < D; ++i) {
+		// t = t + a * b[i]
+		carry = 0;
+		for (j = 0; j < D; ++j) {
+			mul52(a[j], b[i], lo, hi);
+			v = t[j] + lo + carry;
+			t[j] = v & MONT52_DIGIT_MASK;
+			carry = hi + (v >> MONT52_DIGIT_BITS);
+		}
+		t[D] += carry;
+		t[D + 1] += t[D] >> MONT52_DIGIT_BITS;
+		t[D] &= MONT52_DIGIT_MASK;
+
+		// t = (t + y * m) / 2^52
+		y = (t[0] * k0) & MONT52_DIGIT_MASK;
+		mul52(m[0], y, lo, hi);
+		carry = hi + ((t[0] + lo) >> MONT52_DIGIT_BITS);
+		for (j = 1; j < D; ++j) {
+			mul52(m[j], y, lo, hi);
+			v = t[j] + lo + carry;
+			t[j - 1] = v & MONT52_DIGIT_MASK;
+			carry = hi + (v >> MONT52_DIGIT_BITS);
+		}
+		v = t[D] + carry;
+		t[D - 1] = v & MONT52_DIGIT_MASK;
+		t[D] = t[D + 1] + (v >> MONT52_DIGIT_BITS);
+		t[D + 1] = 0;
+	}
+	finalSubtract52(r, t, t[D], m, D);
+}
+
+/**
+ * @brief 			Portable kernel, see MontMul52.
+ */
+template <unsigned int D>
+static void mulScalar52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			const uint64_t *m, uint64_t k0)
+{
+	uint64_t t[D + 2];
+
+	mulDigits52(r, a, b, m, k0, D, t);
+	for (unsigned int j = D; j < MONT52_STRIDE(D); ++j) {
+		r[j] = 0;
+	}
+}
+
+template <unsigned int D>
+static void sqrScalar52(uint64_t *r, const uint64_t *a, const uint64_t *,
+			const uint64_t *m, uint64_t k0)
+{
+	mulScalar52<D>(r, a, a, m, k0);
+}
+
+static const MontKernel52 scalarKernels[] = {
+	{"scalar-52x10", 10, mulScalar52<10>, sqrScalar52<10>},
+	{"scalar-52x20", 20, mulScalar52<20>, sqrScalar52<20>},
+};
+
+#ifdef BIGINT_KERNELS_X86
+/**
+ * @brief 			Montgomery multiplication by AVX-512 IFMA,
+ * 				see MontMul52. Every lane of accumulator keeps
+ * 				one digit in redundant form: products of
+ * 				vpmadd52luq are added to digit i, products of
+ * 				vpmadd52huq to digit i + 1, and only the lowest
+ * 				lane is carried while accumulator is shifted.
+ */
+template <unsigned int D>
+__attribute__((target("avx512f,avx512ifma")))
+static void mulIfma52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+		      const uint64_t *m, uint64_t k0)
+{
+	const unsigned int V = MONT52_STRIDE(D) / 8;
+	const __m512i zero = _mm512_setzero_si512();
+	// lanes 1..8 of pair of vectors, shift down by one lane
+	const __m512i shift = _mm512_set_epi64(8, 7, 6, 5, 4, 3, 2, 1);
+	__m512i A[V], M[V], acc[V];
+	__m512i bi, yv;
+	uint64_t t[MONT52_STRIDE(D)];
+	uint64_t t0, y, carry;
+	unsigned int i, v;
+
+	for (v = 0; v < V; ++v) {
+		A[v] = _mm512_loadu_si512(a + 8 * v);
+		M[v] = _mm512_loadu_si512(m + 8 * v);
+		acc[v] = zero;
+	}
+
+	for (i = 0; i < D; ++i) {
+		bi = _mm512_set1_epi64(b[i]);
+		for (v = 0; v < V; ++v) {
+			acc[v] = _mm512_madd52lo_epu64(acc[v], A[v], bi);
+		}
+		t0 = acc[0][0];
+		y = (t0 * k0) & MONT52_DIGIT_MASK;
+		// low digit of t + y * m is zero, its carry goes to next digit
+		carry = (t0 + ((m[0] * y) & MONT52_DIGIT_MASK)) >> MONT52_DIGIT_BITS;
+		yv = _mm512_set1_epi64(y);
+		for (v = 0; v < V; ++v) {
+			acc[v] = _mm512_madd52lo_epu64(acc[v], M[v], yv);
+		}
+
+		// divide by 2^52: shift lanes down by one
+		for (v = 0; v + 1 < V; ++v) {
+			acc[v] = _mm512_permutex2var_epi64(acc[v], shift, acc[v + 1]);
+		}
+		acc[V - 1] = _mm512_permutex2var_epi64(acc[V - 1], shift, zero);
+		acc[0] = _mm512_mask_add_epi64(acc[0], 1, acc[0], _mm512_set1_epi64(carry));
+
+		for (v = 0; v < V; ++v) {
+			acc[v] = _mm512_madd52hi_epu64(acc[v], A[v], bi);
+			acc[v] = _mm512_madd52hi_epu64(acc[v], M[v], yv);
+		}
+	}
+
+	for (v = 0; v < V; ++v) {
+		_mm512_storeu_si512(t + 8 * v, acc[v]);
+	}
+	// back to 52-bit digits
+	carry = 0;
+	for (i = 0; i < D; ++i) {
+		t[i] += carry;
+		carry = t[i] >> MONT52_DIGIT_BITS;
+		t[i] &= MONT52_DIGIT_MASK;
+	}
+	finalSubtract52(r, t, carry, m, D);
+	for (i = D; i < MONT52_STRIDE(D); ++i) {
+		r[i] = 0;
+	}
+}
+
+template <unsigned int D>
+__attribute__((target("avx512f,avx512ifma")))
+static void sqrIfma52(uint64_t *r, const uint64_t *a, const uint64_t *,
+		      const uint64_t *m, uint64_t k0)
+{
+	mulIfma52<D>(r, a, a, m, k0);
+}
+
+static const MontKernel52 ifmaKernels[] = {
+	{"avx512ifma-52x10", 10, mulIfma52<10>, sqrIfma52<10>},
+	{"avx512ifma-52x20", 20, mulIfma52<20>, sqrIfma52<20>},
+};
+
+/**
+ * @brief 			Check CPU and OS support of AVX-512 IFMA.
+ */
+static bool cpuHasIfma()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+}
+#endif
+
+/**
+ * @brief 			Kernel of table for module of `bits` length.
+ * 				Kernel of 2k digits is not used for modules
+ * 				which fit to k digits.
+ */
+template <unsigned int N>
+static const MontKernel52* findKernel(const MontKernel52 (&kernels)[N], unsigned int bits)
+{
+	for (unsigned int i = 0; i < N; ++i) {
+		if (bits <= kernels[i].digits * MONT52_DIGIT_BITS &&
+		    2 * bits > kernels[i].digits * MONT52_DIGIT_BITS) {
+			return &kernels[i];
+		}
+	}
+	return NULL;
+}
+
+const MontKernel52* getMontKernel52(unsigned int bits)
+{
+#ifdef BIGINT_KERNELS_X86
+	static const bool hasIfma = cpuHasIfma();
+
+	if (hasIfma && kernelsEnabled) {
+		return findKernel(ifmaKernels, bits);
+	}
+#endif
+	(void)bits;
+	return NULL;
+}
+
+const MontKernel52* getScalarMontKernel52(unsigned int bits)
+{
+	return findKernel(scalarKernels, bits);
+}
+
+void setMontKernels52Enabled(bool enabled)
+{
+	kernelsEnabled = enabled;
+}
+
+#ifdef BIGINT_KERNELS_X86
+/**
+ * @brief 			Lane-parallel Montgomery multiplication by
+ * 				AVX-512 IFMA, see montMulBatch52. Vector of
+ * 				digit j has digits j of all lanes, digits of
+ * 				accumulator are kept in redundant form and only
+ * 				the lowest one is carried.
+ */
+__attribute__((target("avx512f,avx512ifma")))
+static void mulBatchIfma52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			   const uint64_t *m, uint64_t k0, unsigned int digits,
+			   uint64_t *scratch)
+{
+	const unsigned int D = digits;
+	const __m512i zero = _mm512_setzero_si512();
+	const __m512i mask = _mm512_set1_epi64(MONT52_DIGIT_MASK);
+	const __m512i k0v = _mm512_set1_epi64(k0);
+	__m512i bi, y, aj, mj, t, prevA, prevM, carry;
+	uint64_t *acc = scratch;
+	unsigned int i, j;
+
+	for (j = 0; j < D; ++j) {
+		_mm512_storeu_si512(acc + j * BATCH52_LANES, zero);
+	}
+
+	for (i = 0; i < D; ++i) {
+		bi = _mm512_loadu_si512(b + i * BATCH52_LANES);
+		aj = _mm512_loadu_si512(a);
+		mj = _mm512_set1_epi64(m[0]);
+		t = _mm512_madd52lo_epu64(_mm512_loadu_si512(acc), aj, bi);
+		y = _mm512_madd52lo_epu64(zero, t, k0v);
+		t = _mm512_madd52lo_epu64(t, mj, y);
+		// low digit is zero, its carry goes to the next digit
+		carry = _mm512_maskz_srli_epi64(0xFF, t, MONT52_DIGIT_BITS);
+		prevA = aj;
+		prevM = mj;
+
+		// acc = (acc + a * b[i] + y * m) / 2^52
+		for (j = 1; j < D; ++j) {
+			aj = _mm512_loadu_si512(a + j * BATCH52_LANES);
+			mj = _mm512_set1_epi64(m[j]);
+			t = _mm512_loadu_si512(acc + j * BATCH52_LANES);
+			t = _mm512_madd52lo_epu64(t, aj, bi);
+			t = _mm512_madd52lo_epu64(t, mj, y);
+			t = _mm512_madd52hi_epu64(t, prevA, bi);
+			t = _mm512_madd52hi_epu64(t, prevM, y);
+			if (j == 1) {
+				t = _mm512_add_epi64(t, carry);
+			}
+			_mm512_storeu_si512(acc + (j - 1) * BATCH52_LANES, t);
+			prevA = aj;
+			prevM = mj;
+		}
+		t = _mm512_madd52hi_epu64(zero, prevA, bi);
+		t = _mm512_madd52hi_epu64(t, prevM, y);
+		if (D == 1) {
+			t = _mm512_add_epi64(t, carry);
+		}
+		_mm512_storeu_si512(acc + (D - 1) * BATCH52_LANES, t);
+	}
+
+	// back to 52-bit digits
+	carry = zero;
+	for (j = 0; j < D; ++j) {
+		t = _mm512_add_epi64(_mm512_loadu_si512(acc + j * BATCH52_LANES), carry);
+		carry = _mm512_maskz_srli_epi64(0xFF, t, MONT52_DIGIT_BITS);
+		_mm512_storeu_si512(acc + j * BATCH52_LANES, _mm512_and_si512(t, mask));
+	}
+	_mm512_storeu_si512(acc + D * BATCH52_LANES, carry);
+
+	// subtraction of m, lane by lane
+	uint64_t *lane = scratch + (D + 1) * BATCH52_LANES;
+	for (unsigned int l = 0; l < BATCH52_LANES; ++l) {
+		for (j = 0; j < D; ++j) {
+			lane[j] = acc[j * BATCH52_LANES + l];
+		}
+		finalSubtract52(lane, lane, acc[D * BATCH52_LANES + l], m, D);
+		for (j = 0; j < D; ++j) {
+			r[j * BATCH52_LANES + l] = lane[j];
+		}
+	}
+}
+#endif
+
+/**
+ * @brief 			Lane-parallel Montgomery multiplication lane
+ * 				by lane, see montMulBatch52.
+ */
+static void mulBatchScalar52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+			     const uint64_t *m, uint64_t k0, unsigned int digits,
+			     uint64_t *scratch)
+{
+	const unsigned int D = digits;
+	uint64_t *x = scratch, *y = x + D, *res = y + D, *t = res + D;
+	unsigned int j, l;
+
+	for (l = 0; l < BATCH52_LANES; ++l) {
+		for (j = 0; j < D; ++j) {
+			x[j] = a[j * BATCH52_LANES + l];
+			y[j] = b[j * BATCH52_LANES + l];
+		}
+		mulDigits52(res, x, y, m, k0, D, t);
+		for (j = 0; j < D; ++j) {
+			r[j * BATCH52_LANES + l] = res[j];
+		}
+	}
+}
+
+void montMulBatch52(uint64_t *r, const uint64_t *a, const uint64_t *b,
+		    const uint64_t *m, uint64_t k0, unsigned int digits,
+		    uint64_t *scratch)
+{
+#ifdef BIGINT_KERNELS_X86
+	if (hasMontBatch52()) {
+		mulBatchIfma52(r, a, b, m, k0, digits, scratch);
+		return;
+	}
+#endif
+	mulBatchScalar52(r, a, b, m, k0, digits, scratch);
+}
+
+bool hasMontBatch52()
+{
+#ifdef BIGINT_KERNELS_X86
+	static const bool hasIfma = cpuHasIfma();
+
+	return hasIfma && kernelsEnabled;
+#else
+	return false;
+#endif
+}
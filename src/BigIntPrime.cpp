@@ -1,154 +1,493 @@
 #include "BigInt.h"
+#include "ThreadPool.h"
 #include "logger.h"
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
 
 #define WORD_BITS	32
 #define ROUNDS_MR_TEST 3
 
-void BigInt::generatePrime(RandomGenerator &gen)
+/* amount of odd primes for sieving of candidates */
+#ifndef SMALL_PRIMES_COUNT
+#define SMALL_PRIMES_COUNT 2048
+#endif
+
+/* amount of candidates sieved at once */
+#ifndef SIEVE_WINDOW
+#define SIEVE_WINDOW 4096
+#endif
+
+#define BLOCK_MAX_NUMBER	(~(block)0 >> (sizeof(block) * 8 - BIGINT_BLOCK_BITS))
+
+/*
+ * Odd small primes grouped to batches. Product of primes of one batch
+ * fits to one block, so candidate is reduced once per batch and each
+ * prime is checked by remainder of the product.
+ */
+struct SmallPrimesTable {
+	std::vector<block> primes;
+	std::vector<block> products;
+	/* index of first prime after batch */
+	std::vector<unsigned int> ends;
+};
+
+/**
+ * @brief 			Find small primes and group them to batches.
+ */
+static SmallPrimesTable buildSmallPrimes()
 {
+	SmallPrimesTable table;
+	block candidate, product = 1;
+	unsigned int i;
+	bool isPrime;
 
-	int size = length_ / WORD_BITS;
-	std::vector<block> randArray(size);
-	int i = 0;
+	table.primes.reserve(SMALL_PRIMES_COUNT);
+	for (candidate = 3; table.primes.size() < SMALL_PRIMES_COUNT; candidate += 2) {
+		isPrime = true;
+		for (i = 0; i < table.primes.size() &&
+		     table.primes[i] * table.primes[i] <= candidate; ++i) {
+			if (candidate % table.primes[i] == 0) {
+				isPrime = false;
+				break;
+			}
+		}
+		if (isPrime) {
+			table.primes.push_back(candidate);
+		}
+	}
 
-	do {
-		do {
-			randArray[0] = gen.next32bit();
-		} while ((randArray[0] & 1) == 0);
-		for (i = 1; i < size; ++i) {
-			randArray[i] = gen.next32bit();
+	for (i = 0; i < table.primes.size(); ++i) {
+		if (product > BLOCK_MAX_NUMBER / table.primes[i]) {
+			table.products.push_back(product);
+			table.ends.push_back(i);
+			product = 1;
+		}
+		product *= table.primes[i];
+	}
+	table.products.push_back(product);
+	table.ends.push_back(i);
+	return table;
+}
+
+/**
+ * @brief 			Table of first SMALL_PRIMES_COUNT odd primes.
+ * 				It is built at first call.
+ */
+static const SmallPrimesTable& getSmallPrimes()
+{
+	static const SmallPrimesTable table = buildSmallPrimes();
+	return table;
+}
+
+/**
+ * @brief 			Mark k in window when start + step * k is
+ * 				divisible by one of small primes.
+ * @param residues		- INPUT. Remainders of start by small primes.
+ * @param sieve			[output] 1 for marked numbers of window.
+ */
+static void sieveWindow(const std::vector<block> &residues, std::vector<uint8_t> &sieve,
+			unsigned int step)
+{
+	const SmallPrimesTable &table = getSmallPrimes();
+	block p, half, invStep, k;
+
+	std::fill(sieve.begin(), sieve.end(), 0);
+	for (unsigned int i = 0; i < table.primes.size(); ++i) {
+		// mark k when start + step * k = 0 (mod p)
+		p = table.primes[i];
+		half = (p + 1) / 2;
+		invStep = step == 2 ? half : half * half % p;
+		for (k = (p - residues[i]) % p * invStep % p; k < SIEVE_WINDOW; k += p) {
+			sieve[k] = 1;
 		}
-		rawArrayToBlocks(randArray);
-	} while (!testSimpleDivision() || !testMillerRabin(ROUNDS_MR_TEST, gen, randArray));
+	}
 }
 
-void BigInt::generateBlumPrime(RandomGenerator &gen, BigInt &r, BigInt &s)
+/**
+ * @brief 			Remainders of start of the next window.
+ */
+static void moveResidues(std::vector<block> &residues, unsigned int step)
+{
+	const SmallPrimesTable &table = getSmallPrimes();
+
+	for (unsigned int i = 0; i < table.primes.size(); ++i) {
+		residues[i] = (residues[i] + step * SIEVE_WINDOW) % table.primes[i];
+	}
+}
+
+/*
+ * Bases of Miller-Rabin test for one candidate of parallel search:
+ * SplitMix64 sequence started from seed and number of candidate.
+ * Bases depend only on candidate and creation costs nothing, so it is
+ * made for every candidate.
+ */
+class CandidateBases : public RandomGenerator {
+public:
+	CandidateBases(uint64_t seed, uint64_t candidate) : state(candidate)
+	{
+		state = seed ^ splitMix64(state);
+	}
+	unsigned int next32bit() { return splitMix64(state) >> 32; }
+private:
+	uint64_t state;
+};
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generatePrime(RandomGenerator &gen)
+{
+	Workspace ws;
+	generatePrime(gen, ws);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generatePrime(RandomGenerator &gen, Workspace &ws)
+{
+	searchPrime(gen, ws, length_ / WORD_BITS, 2);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generateBlumPrime(RandomGenerator &gen, FixedBigInt &r, FixedBigInt &s)
+{
+	Workspace ws;
+	generateBlumPrime(gen, r, s, ws);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generateBlumPrime(RandomGenerator &gen, FixedBigInt &r, FixedBigInt &s,
+					  Workspace &ws)
 {
 	int size = length_ / WORD_BITS;
 	int partSize = size / 2;
-	std::vector<block> randArray(size);
 
 	LOG("r part Blum number generating...");
-	r.generatePartBlumPrime(gen, randArray, partSize);
+	r.generatePartBlumPrime(gen, ws, partSize);
 	LOG("s part Blum number generating...");
-	s.generatePartBlumPrime(gen, randArray, partSize);
-	r.mulHalfNumbers(s, *this);
+	s.generatePartBlumPrime(gen, ws, partSize);
+	r.mul(s, *this);
 }
 
-void BigInt::generateBlumPrime(RandomGenerator &gen)
+/**
+ * @brief 			Both parts are searched by windows like in
+ * 				`searchPrime`. Sieve is done by caller and
+ * 				candidates of window are dealt to threads by
+ * 				stride. Thread which found prime cancels tests
+ * 				of candidates after it, candidates before it
+ * 				are still tested, so the first prime of window
+ * 				is taken.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generateBlumPrime(RandomGenerator &gen, FixedBigInt &r, FixedBigInt &s,
+					  ThreadPool &pool)
 {
-	BigInt r, s;
+	const int words = length_ / WORD_BITS / 2;
+	const unsigned int step = 4;
+	const size_t notFound = ~(size_t)0;
+	const unsigned int strides = pool.size();
+
+	struct Search {
+		FixedBigInt start;
+		std::vector<block> residues;
+		std::vector<uint8_t> sieve;
+		std::vector<block> candidates;
+		uint64_t seed;
+		uint64_t window;
+		bool done;
+	} search[2];
+	std::atomic<size_t> found[2];
+	FixedBigInt *result[2] = {&r, &s};
+	std::vector<uint32_t> randArray(length_ / WORD_BITS);
+	std::vector<std::unique_ptr<Workspace>> spaces;
+	FixedBigInt delta;
+	unsigned int h;
+	block k;
+
+	// everything which is taken from generator is taken by this thread
+	for (h = 0; h < 2; ++h) {
+		search[h].seed = gen.next32bit();
+		search[h].seed = search[h].seed << 32 | gen.next32bit();
+		search[h].window = 0;
+		search[h].done = false;
+		search[h].residues.resize(getSmallPrimes().primes.size());
+		search[h].sieve.resize(SIEVE_WINDOW);
+		search[h].start.randomStart(gen, randArray, words, step);
+		search[h].start.smallPrimesResidues(search[h].residues);
+	}
+	for (h = 0; h < strides; ++h) {
+		spaces.emplace_back(new Workspace());
+	}
+
+	while (!search[0].done || !search[1].done) {
+		for (h = 0; h < 2; ++h) {
+			found[h] = notFound;
+			search[h].candidates.clear();
+			if (search[h].done) {
+				continue;
+			}
+			sieveWindow(search[h].residues, search[h].sieve, step);
+			for (k = 0; k < SIEVE_WINDOW; ++k) {
+				if (!search[h].sieve[k]) {
+					search[h].candidates.push_back(k);
+				}
+			}
+		}
+
+		pool.run(2 * strides, [&](unsigned int worker, size_t item) {
+			Search &sr = search[item % 2];
+			std::atomic<size_t> &first = found[item % 2];
+			FixedBigInt x, d;
+
+			for (size_t i = item / 2; i < sr.candidates.size() && i < first; i += strides) {
+				x.blocks_ = sr.start.blocks_;
+				d.setNumber(step * sr.candidates[i]);
+				if (x.add(d) || x.getPosMostSignificatnBit() >= words * WORD_BITS) {
+					break;
+				}
+				CandidateBases bases(sr.seed, sr.window * SIEVE_WINDOW + sr.candidates[i]);
+				if (x.testMillerRabin(ROUNDS_MR_TEST, bases, *spaces[worker])) {
+					size_t current = first;
+					while (i < current && !first.compare_exchange_weak(current, i)) {
+					}
+					return;
+				}
+			}
+		});
+
+		for (h = 0; h < 2; ++h) {
+			Search &sr = search[h];
+
+			if (sr.done) {
+				continue;
+			}
+			if (found[h] != notFound) {
+				result[h]->blocks_ = sr.start.blocks_;
+				delta.setNumber(step * sr.candidates[found[h]]);
+				result[h]->add(delta);
+				sr.done = true;
+				continue;
+			}
+			// move window while numbers fit to words, new start otherwise
+			++sr.window;
+			delta.setNumber(step * SIEVE_WINDOW);
+			if (sr.start.add(delta) || sr.start.getPosMostSignificatnBit() >= words * WORD_BITS) {
+				sr.start.randomStart(gen, randArray, words, step);
+				sr.start.smallPrimesResidues(sr.residues);
+			} else {
+				moveResidues(sr.residues, step);
+			}
+		}
+	}
+	r.mul(s, *this);
+}
+
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generateBlumPrime(RandomGenerator &gen)
+{
+	FixedBigInt r, s;
 	generateBlumPrime(gen, r, s);
 }
 
-void BigInt::generatePartBlumPrime(RandomGenerator &gen,
-				   std::vector<block> &randArray, int partSize)
+template <unsigned int Bits>
+void FixedBigInt<Bits>::generatePartBlumPrime(RandomGenerator &gen, Workspace &ws, int partSize)
 {
 	// need two numbers that are twice smaller than result number
-	int size = randArray.size();
-	int i = 0;
+	assert(partSize < (int)(length_ / WORD_BITS));
 
-	assert(partSize < size);
+	searchPrime(gen, ws, partSize, 4);
+}
 
-	do {
-		do {
-			randArray[0] = gen.next32bit();
-			//DEBUG("Generate first block of Blum number.");
-		} while ((randArray[0] & 3) != 3);
-		for (i = 1; i < partSize; ++i) {
-			randArray[i] = gen.next32bit();
-		}
-		for (;i < size; ++i) {
-			randArray[i] = 0;
+/**
+ * @brief 			Remainders of this number by small primes.
+ * @param residues		[output] Remainder for every prime of table.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::smallPrimesResidues(std::vector<block> &residues) const
+{
+	const SmallPrimesTable &table = getSmallPrimes();
+	unsigned int i = 0;
+	block rem;
+
+	assert(residues.size() == table.primes.size());
+
+	for (unsigned int batch = 0; batch < table.products.size(); ++batch) {
+		rem = modWord(table.products[batch]);
+		for (; i < table.ends[batch]; ++i) {
+			residues[i] = rem % table.primes[i];
 		}
-		rawArrayToBlocks(randArray);
-	} while (!testSimpleDivision() || !testMillerRabin(ROUNDS_MR_TEST, gen, randArray));
+	}
 }
 
-bool BigInt::testSimpleDivision()
+/**
+ * @brief 			Random start of prime search: number of `words`
+ * 				32-bit words congruent to step - 1 modulo step.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::randomStart(RandomGenerator &gen, std::vector<uint32_t> &randArray,
+				    int words, unsigned int step)
 {
-	BigInt y, r, q;
-	int simplePrimes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
-	int size = sizeof(simplePrimes) / sizeof(simplePrimes[0]);
+	gen.fill(randArray.data(), words);
+	std::fill(randArray.begin() + words, randArray.end(), 0);
+	randArray[0] |= step - 1;
+	rawArrayToBlocks(randArray);
+}
 
-	// we never get that 2 is divider, because this situation is handled
-	// during generation of number
-	assert(isEven() == false);
+/**
+ * @brief 			Incremental search of prime number.
+ * 				Random start is taken and candidates
+ * 				start + step * k are sieved by small primes in
+ * 				windows of SIEVE_WINDOW numbers. Remainders of
+ * 				start by small primes are computed once and then
+ * 				only moved with the window. Miller-Rabin test is
+ * 				done only for numbers which passed the sieve.
+ * @param words			- INPUT. Amount of 32-bit words of prime.
+ * @param step			- INPUT. 2 for odd prime, 4 for prime
+ * 				congruent to 3 modulo 4.
+ */
+template <unsigned int Bits>
+void FixedBigInt<Bits>::searchPrime(RandomGenerator &gen, Workspace &ws, int words,
+				    unsigned int step)
+{
+	std::vector<uint32_t> &randArray = ws.rawArray_;
+	std::vector<block> &residues = ws.residues_;
+	std::vector<uint8_t> &sieve = ws.sieve_;
+	FixedBigInt &start = ws.start_;
+	FixedBigInt delta;
+	block k;
 
-	for (int i = 0; i < size; ++i) {
-		y.setNumber(simplePrimes[i]);
-		div(y, q, r);
-		if (r.isZero()) {
-			//LOG("Number has divider {}", simplePrimes[i]);
-			return false;
+	assert(step == 2 || step == 4);
+	assert(words <= (int)randArray.size());
+
+	residues.resize(getSmallPrimes().primes.size());
+	sieve.resize(SIEVE_WINDOW);
+
+	while (true) {
+		start.randomStart(gen, randArray, words, step);
+		start.smallPrimesResidues(residues);
+
+		// move window while numbers fit to words
+		while (start.getPosMostSignificatnBit() < words * WORD_BITS) {
+			sieveWindow(residues, sieve, step);
+
+			for (k = 0; k < SIEVE_WINDOW; ++k) {
+				if (sieve[k]) {
+					continue;
+				}
+				blocks_ = start.blocks_;
+				delta.setNumber(step * k);
+				if (add(delta) || getPosMostSignificatnBit() >= words * WORD_BITS) {
+					break;
+				}
+				if (testMillerRabin(ROUNDS_MR_TEST, gen, ws)) {
+					return;
+				}
+			}
+
+			delta.setNumber(step * SIEVE_WINDOW);
+			if (start.add(delta)) {
+				break;
+			}
+			moveResidues(residues, step);
 		}
 	}
-	return true;
 }
 
-bool BigInt::isDivisor(BigInt &x)
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::isDivisor(FixedBigInt &x, Workspace &ws)
 {
-	BigInt r, q;
+	FixedBigInt &q = ws.temp_[0];
+	FixedBigInt &r = ws.temp_[1];
 	div(x, q, r);
 	return r.isZero();
 }
 
-bool BigInt::testMillerRabin_real(int k, RandomGenerator &gen, std::vector<block> &randArray)
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::testMillerRabin_real(int k, RandomGenerator &gen, Workspace &ws)
 {
-	BigInt d, one, x, minusOne, res;//, copyX;
+	const ModContext &ctx = *context_;
+	FixedBigInt d, one, x, minusOne, res;
+	bool foundMinusOne;
 
+	// d = m - 1, then one and minus one are kept in Montgomery form
 	one.setNumber(1);
+	d.copyContent(*this);
+	d.sub(one);
+	one.toMont(ctx, one);
 	minusOne.copyContent(*this);
 	minusOne.sub(one);
 
-	d.copyContent(minusOne);
-
 	block s = 0;
 	while (d.getBit(0) == 0) {
 		d.shiftRightBit();
 		++s;
 	}
+	ws.exponent_.recode(d);
 
 	for (int i = 0; i < k; ++i) {
 		do {
 			//LOG("Generare new x...");
-			x.generateRand(gen, randArray, posMostSignBit_);
-			x.mod(*this);
+			x.generateRand(gen, ws.rawArray_, ctx.posMostSignBit_);
+			x.mod(ctx, ws);
 		} while (x.cmp(1) != 1);
 
-		if (isDivisor(x)) {
+		if (isDivisor(x, ws)) {
 //			LOG("Generated x is divisor for p. x = {}, p = {}",
 //			    x.toString(), toString());
 //			LOG("P is NOT pseudosimple for base x. (1)");
 			return false;
 		}
-		//copyX.copyContent(x);
-		x.exp(d, *this, res);
+		if (ctx.kernel_) {
+			// vectorized kernel returns result in normal form
+			x.exp(ws.exponent_, ctx, res, ws);
+			res.toMont(ctx, res);
+		} else {
+			x.expMont(ws.exponent_, ctx, res, ws);
+		}
 		if (res.isEqual(one) || res.isEqual(minusOne)) {
 			//LOG("P is pseudosimple for base x. (2))");
 			continue;
 		}
-		for (block r = 1; r < s; ++r) {
-			res.mulMont(res, *this, res);
+		foundMinusOne = false;
+		for (block r = 1; r < s && !foundMinusOne; ++r) {
+			res.montSqr(ctx, res);
 			if (res.isEqual(one)) {
 				//LOG("P is NOT pseudosimple for base x. (3)");
 				return false;
-			} else if (res.isEqual(minusOne)) {
-				//LOG("P is pseudosimple for base x. (3)");
-				continue;
 			}
+			foundMinusOne = res.isEqual(minusOne);
+		}
+		if (!foundMinusOne) {
+			//LOG("After all steps P is NOT pseudosimple for base x. (4)");
+			return false;
 		}
-		//LOG("After all steps P is NOT pseudosimple for base x. (4)");
-		return false;
 	}
 	return true;
 }
 
-bool BigInt::testMillerRabin(int k, RandomGenerator &gen, std::vector<block> &randArray)
+template <unsigned int Bits>
+bool FixedBigInt<Bits>::testMillerRabin(int k, RandomGenerator &gen, Workspace &ws)
 {
-	initModularReduction();
-	bool res = testMillerRabin_real(k, gen, randArray);
+	initModularReduction(ws);
+	bool res = testMillerRabin_real(k, gen, ws);
 	shutDownModularReduction();
 	return res;
 }
+
+#define INSTANTIATE_BIGINT_PRIME(bits)							\
+	template void FixedBigInt<bits>::generatePrime(RandomGenerator &);		\
+	template void FixedBigInt<bits>::generatePrime(RandomGenerator &,		\
+						BigIntWorkspace<bits> &);		\
+	template void FixedBigInt<bits>::generateBlumPrime(RandomGenerator &);		\
+	template void FixedBigInt<bits>::generateBlumPrime(RandomGenerator &,		\
+						FixedBigInt<bits> &, FixedBigInt<bits> &);	\
+	template void FixedBigInt<bits>::generateBlumPrime(RandomGenerator &,		\
+						FixedBigInt<bits> &, FixedBigInt<bits> &,	\
+						BigIntWorkspace<bits> &);		\
+	template void FixedBigInt<bits>::generateBlumPrime(RandomGenerator &,		\
+						FixedBigInt<bits> &, FixedBigInt<bits> &,	\
+						ThreadPool &);
+
+INSTANTIATE_BIGINT_PRIME(512)
+INSTANTIATE_BIGINT_PRIME(1024)
+INSTANTIATE_BIGINT_PRIME(2048)
+INSTANTIATE_BIGINT_PRIME(3072)
+INSTANTIATE_BIGINT_PRIME(4096)
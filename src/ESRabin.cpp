@@ -1,136 +1,293 @@
-#include <openssl/sha.h>
-#include <assert.h>
+#include <stdexcept>
 #include "ESRabin.h"
 #include "logger.h"
 
+HashContext::HashContext()
+	: ctx(EVP_MD_CTX_new())
+{
+	if (!ctx) {
+		throw std::bad_alloc();
+	}
+}
+
+HashContext::~HashContext()
+{
+	EVP_MD_CTX_free(ctx);
+}
+
+void HashContext::init(const EVP_MD *md)
+{
+	if (!EVP_DigestInit_ex(ctx, md, NULL)) {
+		throw std::runtime_error("Hash initialization failed.");
+	}
+}
+
+void HashContext::update(const void *data, size_t size)
+{
+	if (!EVP_DigestUpdate(ctx, data, size)) {
+		throw std::runtime_error("Hash update failed.");
+	}
+}
+
+void HashContext::copyFrom(const HashContext &other)
+{
+	if (!EVP_MD_CTX_copy_ex(ctx, other.ctx)) {
+		throw std::runtime_error("Copy of hash state failed.");
+	}
+}
+
+unsigned int HashContext::final(unsigned char *digest)
+{
+	unsigned int size = 0;
+
+	if (!EVP_DigestFinal_ex(ctx, digest, &size)) {
+		throw std::runtime_error("Hash finalization failed.");
+	}
+	return size;
+}
+
 void ESRabinManager::generateKeys(ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey)
 {
-	pubKey.n.generateBlumPrime(generator, privKey.p, privKey.q);
-	pubKey.hash = SHA256;
+	std::lock_guard<std::mutex> guard(lock);
+	BigInt qInv;
+
+	pubKey.n.generateBlumPrime(generator, privKey.p, privKey.q, getPool());
+	if (!privKey.q.modInverse(privKey.p, qInv)) {
+		throw std::runtime_error("Generated primes are not coprime.");
+	}
+	precomputeKeys(pubKey, privKey, qInv);
+}
+
+bool ESRabinManager::loadKeys(const BigInt &p, const BigInt &q,
+			      ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey)
+{
+	BigInt qInv;
+	BigInt::Double n;
+
+	// root exponent (p + 1) / 4 needs p = 3 mod 4, odd p is needed
+	// for inverse, and equal p and q have no inverse
+	if (p.modWord(4) != 3 || q.modWord(4) != 3 || !q.modInverse(p, qInv)) {
+		return false;
+	}
+	p.mul(q, n);
+	if (n.getPosMostSignificatnBit() >= (int)pubKey.n.getLength()) {
+		return false;
+	}
+	privKey.p = p;
+	privKey.q = q;
+	pubKey.n = BigInt(n);
+	precomputeKeys(pubKey, privKey, qInv);
+	return true;
+}
+
+/**
+ * @brief 			Everything of keys which depends only on p and q,
+ * 				so signing needs two half-size exponentiations
+ * 				and one multiplication by module.
+ * @param qInv			- INPUT. q^(-1) mod p.
+ */
+void ESRabinManager::precomputeKeys(ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey,
+				    const BigInt &qInv)
+{
+	pubKey.hash = EVP_sha256();
 	pubKey.nameHashFunc.assign("SHA256");
 
-	pubKey.n.initModularReduction();
-	privKey.p.initModularReduction();
-	privKey.q.initModularReduction();
+	pubKey.nContext = BigInt::ModContext::create(pubKey.n);
+	privKey.pContext = BigInt::ModContext::create(privKey.p);
+	privKey.qContext = BigInt::ModContext::create(privKey.q);
+
+	BigInt one, expP, expQ;
+
+	one.setNumber(1);
+
+	expP = privKey.p + one;
+	expP.shiftRightBlock(2);
+	expQ = privKey.q + one;
+	expQ.shiftRightBlock(2);
+	privKey.rootExpP.recode(expP);
+	privKey.rootExpQ.recode(expQ);
+	privKey.qInv = qInv;
 }
 
 void ESRabinManager::finalizeKeys(ESRabinPublicKey &pubKey, ESRabinPrivateKey &privKey)
 {
-	pubKey.n.shutDownModularReduction();
-	privKey.p.shutDownModularReduction();
-	privKey.q.shutDownModularReduction();
+	pubKey.nContext.reset();
+	privKey.pContext.reset();
+	privKey.qContext.reset();
 }
 
 void ESRabinManager::signMessage(const std::string &message, ESRabinSignature &signature,
 		 const ESRabinPublicKey &pubKey,
 		 const ESRabinPrivateKey &privKey)
 {
-	std::vector<uint8_t> byteArray;
-	std::vector<uint8_t> bytes(message.size());
-	unsigned char digest[SHA256_DIGEST_LENGTH] = {0};
+	std::lock_guard<std::mutex> guard(lock);
 
-	BigInt expP, expQ, one, res, H;
+	sign(message, signature, pubKey, privKey, generator, scratch.workspace,
+	     scratch.prefix, scratch.hash, scratch.byteArray);
+}
 
-	one.setNumber(1);
+void ESRabinManager::signMessages(const std::vector<std::string> &messages,
+				  std::vector<ESRabinSignature> &signatures,
+				  const ESRabinPublicKey &pubKey,
+				  const ESRabinPrivateKey &privKey)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	uint64_t seed = generator.next32bit();
+
+	seed = seed << 32 | generator.next32bit();
+	signatures.resize(messages.size());
+	getPool().run(messages.size(), [&](unsigned int w, size_t i) {
+		Worker &worker = *workers[w];
+		RandomGeneratorMush gen(seed, i);
 
-	expP.copyContent(privKey.p);
-	expP.shiftRightBit(); // do not need sub one
+		sign(messages[i], signatures[i], pubKey, privKey, gen, worker.workspace,
+		     worker.prefix, worker.hash, worker.byteArray);
+	});
+}
 
-	expQ.copyContent(privKey.q);
-	expQ.shiftRightBit(); // do not need sub one
+/**
+ * @brief 			Pool and state of its workers, lock should be held.
+ */
+ThreadPool& ESRabinManager::getPool()
+{
+	if (!pool) {
+		pool.reset(new ThreadPool(threads));
+		for (unsigned int i = 0; i < pool->size(); ++i) {
+			workers.emplace_back(new Worker());
+		}
+	}
+	return *pool;
+}
+
+/**
+ * @brief 			Signing by given generator and temporaries,
+ * 				keys are only read. Message is hashed once to
+ * 				`prefix`, every candidate R continues copy of
+ * 				its state.
+ */
+void ESRabinManager::sign(const std::string &message, ESRabinSignature &signature,
+			  const ESRabinPublicKey &pubKey,
+			  const ESRabinPrivateKey &privKey,
+			  RandomGenerator &gen, BigInt::Workspace &ws,
+			  HashContext &prefix, HashContext &hash,
+			  std::vector<uint8_t> &byteArray)
+{
+	unsigned char digest[EVP_MAX_MD_SIZE] = {0};
+	unsigned int digestSize;
+
+	BigInt H;
 
 	signature.message.assign(message);
+	prefix.init(pubKey.hash);
+	prefix.update(message.data(), message.size());
 
 	while (true) {
-		signature.R.generateRand(generator);
+		signature.R.generateRand(gen);
 		signature.R.getByteArray(byteArray);
 
-		bytes.clear();
-		bytes.insert(bytes.begin(), signature.message.begin(), signature.message.end());
-		bytes.insert(bytes.end(), byteArray.begin(), byteArray.end());
-
-		pubKey.hash(bytes.data(), bytes.size(), digest);
-		H.fromByteArray(digest, SHA256_DIGEST_LENGTH);
+		hash.copyFrom(prefix);
+		hash.update(byteArray.data(), byteArray.size());
+		digestSize = hash.final(digest);
+		H.fromByteArray(digest, digestSize);
 
-		H.exp(expP, privKey.p, res);
-		if (res.isEqual(one)) {
-			H.exp(expQ, privKey.q, res);
-			if (res.isEqual(one)) {
-				INFO("Current H is qadratic residue. '{}'", H.toString());
-				break;
-			}
+		if (H.jacobi(privKey.p) == 1 && H.jacobi(privKey.q) == 1) {
+			INFO("Current H is qadratic residue. '{}'", H.toString());
+			break;
 		}
 		DEBUG("Number '{}' is not qadratic residue", H.toString());
 	}
 	// calculate B
-	calculateBeta(signature, pubKey, privKey, H);
+	calculateBeta(signature, privKey, H, ws);
 }
 
 void ESRabinManager::calculateBeta(ESRabinSignature &signature,
-				   const ESRabinPublicKey &pubKey,
 				   const ESRabinPrivateKey &privKey,
-				   const BigInt &H)
+				   const BigInt &H, BigInt::Workspace &ws)
 {
-	BigInt expP, expQ, one, rootForQ, rootForP;
-
-	one.setNumber(1);
+	BigInt rootForQ, rootForP;
 
 	// calculate H^0.5
-	expP.copyContent(privKey.p);
-	expP.add(one);
-	expP.shiftRightBlock(2);
-
-	expQ.copyContent(privKey.q);
-	expQ.add(one);
-	expQ.shiftRightBlock(2);
+	H.exp(privKey.rootExpP, *privKey.pContext, rootForP, ws);
+	H.exp(privKey.rootExpQ, *privKey.qContext, rootForQ, ws);
 
-	H.exp(expP, privKey.p, rootForP);
-	H.exp(expQ, privKey.q, rootForQ);
-
-	if (rootForQ.cmp(rootForP) == 1) {
-		GarnerAlgorithmCRT(privKey.p, privKey.q, rootForP, rootForQ, signature.B);
-	} else {
-		GarnerAlgorithmCRT(privKey.q, privKey.p, rootForQ, rootForP, signature.B);
-	}
+	GarnerAlgorithmCRT(privKey, rootForP, rootForQ, signature.B, ws);
 }
 
-void ESRabinManager::GarnerAlgorithmCRT(const BigInt &p, const BigInt &q,
+/**
+ * @brief 			Garner's recombination with precomputed
+ * 				qInv = q^(-1) mod p:
+ * 				res = Vq + q * (qInv * (Vp - Vq) mod p).
+ * @param Vp			- INPUT. Residue by p, less than p.
+ * @param Vq			- INPUT. Residue by q, less than q.
+ */
+void ESRabinManager::GarnerAlgorithmCRT(const ESRabinPrivateKey &privKey,
 					const BigInt &Vp, const BigInt &Vq,
-					BigInt &res)
+					BigInt &res, BigInt::Workspace &ws)
 {
-	assert(Vq.cmp(Vp) != -1);
+	BigInt VqModP(Vq), h;
 
-	BigInt exponent, tmp, diff;
+	VqModP.mod(*privKey.pContext, ws);
+	h = Vp - VqModP;
+	if (Vp.cmp(VqModP) == -1) {
+		h = h + privKey.p;
+	}
+	h.mulMontCIOS(privKey.qInv, *privKey.pContext, h);
 
-	exponent.copyContent(q);
-	tmp.setNumber(2);
-	exponent.sub(tmp);
+	res = BigInt(h * privKey.q) + Vq;
+}
 
-	tmp.setZero();
-	p.exp(exponent, q, tmp);
+bool ESRabinManager::checkSignature(const ESRabinSignature &signature,
+				    const ESRabinPublicKey &pubKey)
+{
+	std::lock_guard<std::mutex> guard(lock);
 
-	diff.copyContent(Vq);
-	diff.sub(Vp);
+	return verifySignature(signature, pubKey, scratch.hash, scratch.byteArray);
+}
 
-	diff.mulMont(tmp, q, tmp);
+std::vector<bool> ESRabinManager::checkSignatures(const std::vector<ESRabinSignature> &signatures,
+						  const ESRabinPublicKey &pubKey)
+{
+	std::vector<uint8_t> verified(signatures.size());
+	std::lock_guard<std::mutex> guard(lock);
 
-	tmp.mulHalfNumbers(p, res);
+	// every worker checks with its own hash context and buffer
+	getPool().run(signatures.size(), [&](unsigned int w, size_t i) {
+		Worker &worker = *workers[w];
 
-	res.add(Vp);
+		verified[i] = verifySignature(signatures[i], pubKey, worker.hash,
+					      worker.byteArray);
+	});
+	return std::vector<bool>(verified.begin(), verified.end());
 }
 
-bool ESRabinManager::checkSignature(const ESRabinSignature &signature,
-				    const ESRabinPublicKey &pubKey)
+/**
+ * @brief 			Check of one signature with buffers of caller,
+ * 				uses only read-only data of public key.
+ */
+bool ESRabinManager::verifySignature(const ESRabinSignature &signature,
+				     const ESRabinPublicKey &pubKey,
+				     HashContext &hash,
+				     std::vector<uint8_t> &byteArray)
 {
 	BigInt H, res;
-	std::vector<uint8_t> byteArray = signature.R.getByteArray();
-	std::vector<uint8_t> bytes(signature.message.begin(), signature.message.end());
-	unsigned char digest[SHA256_DIGEST_LENGTH] = {0};
+	unsigned char digest[EVP_MAX_MD_SIZE] = {0};
+	unsigned int digestSize;
 
-	bytes.insert(bytes.end(), byteArray.begin(), byteArray.end());
-	pubKey.hash(bytes.data(), bytes.size(), digest);
-	H.fromByteArray(digest, SHA256_DIGEST_LENGTH);
+	// key should be generated or loaded
+	if (!pubKey.hash || !pubKey.nContext) {
+		return false;
+	}
+	// B is not trusted, square is defined only for B < n
+	if (signature.B.cmp(pubKey.n) != -1) {
+		return false;
+	}
+	signature.R.getByteArray(byteArray);
+	hash.init(pubKey.hash);
+	hash.update(signature.message.data(), signature.message.size());
+	hash.update(byteArray.data(), byteArray.size());
+	digestSize = hash.final(digest);
+	H.fromByteArray(digest, digestSize);
 
-	signature.B.mulMont(signature.B, pubKey.n, res);
+	signature.B.sqrMod(*pubKey.nContext, res);
 	return H.isEqual(res);
 }
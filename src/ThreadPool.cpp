@@ -0,0 +1,162 @@
+#include <algorithm>
+#include "ThreadPool.h"
+
+/*
+ * Ranges per worker in one run. Smaller ranges balance better,
+ * larger ranges take locks of queues less often.
+ */
+#define RANGES_PER_WORKER		4
+
+/*
+ * Pool and index of worker which runs current thread, if any.
+ */
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local unsigned int currentWorker = 0;
+
+ThreadPool::ThreadPool(unsigned int threads)
+	: generation_(0), pending_(0), stop_(false)
+{
+	if (threads == 0) {
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	for (unsigned int i = 0; i < threads; ++i) {
+		queues_.emplace_back(new Queue());
+	}
+	for (unsigned int i = 0; i < threads; ++i) {
+		threads_.emplace_back(&ThreadPool::work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		stop_ = true;
+	}
+	start_.notify_all();
+	for (std::thread &t : threads_) {
+		t.join();
+	}
+}
+
+unsigned int ThreadPool::size() const
+{
+	return queues_.size();
+}
+
+/**
+ * @brief 			Split indexes to ranges, deal them to queues of
+ * 				workers one by one and wait until every range
+ * 				is finished. Ranges could be taken by workers
+ * 				before they are woken up.
+ */
+void ThreadPool::run(size_t count, const Task &task)
+{
+	if (count == 0) {
+		return;
+	}
+	if (currentPool == this) {
+		// nested run: other workers could wait for this one
+		for (size_t i = 0; i < count; ++i) {
+			task(currentWorker, i);
+		}
+		return;
+	}
+	std::lock_guard<std::mutex> runGuard(runLock_);
+	const size_t ranges = std::min<size_t>(count, size() * RANGES_PER_WORKER);
+	const size_t chunk = count / ranges;
+	const size_t rest = count % ranges;
+	size_t begin = 0, end;
+	std::exception_ptr error;
+
+	// counter is set before ranges are published: worker of previous
+	// run could still take ranges and finish them before notification
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		pending_ = ranges;
+	}
+	for (size_t r = 0; r < ranges; ++r) {
+		Queue &queue = *queues_[r % size()];
+
+		end = begin + chunk + (r < rest ? 1 : 0);
+		std::lock_guard<std::mutex> guard(queue.lock);
+		queue.ranges.push_back(Range{begin, end, &task});
+		begin = end;
+	}
+	{
+		std::unique_lock<std::mutex> guard(lock_);
+
+		++generation_;
+		start_.notify_all();
+		finish_.wait(guard, [this] { return pending_ == 0; });
+		std::swap(error, error_);
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+/**
+ * @brief 			Own queue is used as stack, the oldest ranges
+ * 				of other queues are stolen.
+ * @return 			false if all queues are empty.
+ */
+bool ThreadPool::take(unsigned int worker, Range &range)
+{
+	for (unsigned int i = 0; i < size(); ++i) {
+		Queue &queue = *queues_[(worker + i) % size()];
+		std::lock_guard<std::mutex> guard(queue.lock);
+
+		if (queue.ranges.empty()) {
+			continue;
+		}
+		if (i == 0) {
+			range = queue.ranges.back();
+			queue.ranges.pop_back();
+		} else {
+			range = queue.ranges.front();
+			queue.ranges.pop_front();
+		}
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::work(unsigned int worker)
+{
+	unsigned long seen = 0;
+	Range range;
+
+	currentPool = this;
+	currentWorker = worker;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock_);
+
+			start_.wait(guard, [&] { return stop_ || generation_ != seen; });
+			if (stop_) {
+				return;
+			}
+			seen = generation_;
+		}
+		while (take(worker, range)) {
+			std::exception_ptr error;
+
+			try {
+				for (size_t i = range.begin; i < range.end; ++i) {
+					(*range.task)(worker, i);
+				}
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> guard(lock_);
+			if (error && !error_) {
+				error_ = error;
+			}
+			if (--pending_ == 0) {
+				finish_.notify_all();
+			}
+		}
+	}
+}
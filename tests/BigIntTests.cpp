@@ -5,9 +5,15 @@
 #include <string>
 #include <string.h>
 #include <array>
+#include <atomic>
 #include <assert.h>
 #include <ctime>
+#include <utility>
+#include <thread>
 #include "BigInt.h"
+#include "BigIntKernels.h"
+#include "ThreadPool.h"
+#include "ESRabin.h"
 
 
 #define GREEN	"\033[1;32m"
@@ -63,6 +69,17 @@ do {									\
 } while (0)
 
 
+/*
+ * Generator with fixed sequence for reproducible tests.
+ */
+class SeededGenerator : public RandomGenerator {
+public:
+	explicit SeededGenerator(uint32_t seed) : rng(seed) {}
+	unsigned int next32bit() { return rng(); }
+private:
+	std::mt19937 rng;
+};
+
 void testConvertToFromString()
 {
 	std::array<char, 16> hexChars = {{'0', '1', '2', '3', '4', '5', '6', '7',
@@ -76,6 +93,28 @@ void testConvertToFromString()
 	assertMsg(str == new_str, "String is not equals.");
 }
 
+void testByteArray()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	static const char hexChars[] = "0123456789ABCDEF";
+	std::vector<uint8_t> bytes;
+	std::string str;
+	BigInt a;
+
+	for (int i = 0; i < 10; ++i) {
+		a.generateRand(gen);
+		a.getByteArray(bytes);
+		assertEqualMsg(bytes.size(), 128u, "Wrong count of bytes.");
+		// lowest byte goes first
+		str.clear();
+		for (size_t j = bytes.size(); j > 0; --j) {
+			str.push_back(hexChars[bytes[j - 1] >> 4]);
+			str.push_back(hexChars[bytes[j - 1] & 0xF]);
+		}
+		assertStrMsg(str, a.toString(), "Bytes are not equal to number.");
+	}
+}
+
 void testSetValues()
 {
 	BigInt number;
@@ -293,23 +332,20 @@ void testIsEqual()
 	b.setMax();
 	assertMsg(a.isEqual(b), "IsEqual with equal len of numbers was failed.");
 
-	BigInt *res = BigInt::getDoubleNumber();
+	BigInt::Double res;
 	a.setMax();
-	res->copyContent(a);
+	res.copyContent(a);
 
-	assertMsg(a.isEqual(*res), "IsEqual(t) with greater number was failed.");
-	assertMsg(res->isEqual(a), "IsEqual(t) with less number was failed.");
+	assertMsg(a.isEqual(res), "IsEqual(t) with greater number was failed.");
+	assertMsg(res.isEqual(a), "IsEqual(t) with less number was failed.");
 
-	res->shiftLeftBlock(29);
+	res.shiftLeftBlock(29);
 	for (int i = 0; i < 29; ++i) {
-		res->setBit(i, 1);
+		res.setBit(i, 1);
 	}
 
-	assertMsg(a.isEqual(*res) == false, "IsEqual(f) with greater number was failed.");
-	assertMsg(res->isEqual(a) == false, "IsEqual(f) with less number was failed.");
-
-	delete res;
-
+	assertMsg(a.isEqual(res) == false, "IsEqual(f) with greater number was failed.");
+	assertMsg(res.isEqual(a) == false, "IsEqual(f) with less number was failed.");
 }
 
 void testMontgomeryMultiplication()
@@ -366,6 +402,223 @@ void testMontgomeryMultiplication()
 
 }
 
+void testMontgomeryMultiplicationCIOS()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt x, y, m, check, ret;
+
+	x.fromString("4cd");
+	y.fromString("16a0");
+	m.fromString("11bbf");
+	check.setNumber(0x11AC1);
+
+	m.initModularReduction();
+	x.mulMontCIOS(y, m, ret);
+	m.shutDownModularReduction();
+	assertMsg(ret.isEqual(check), "Fail CIOS mont mul in midle case.");
+
+	x.fromString("4B");
+	y.fromString("4B");
+	m.fromString("6D");
+	check.fromString("42");
+
+	m.initModularReduction();
+	x.mulMontCIOS(x, m, ret);
+	m.shutDownModularReduction();
+	assertMsg(ret.isEqual(check), "Fail CIOS mont mul in squaring case.");
+
+	for (int i = 0; i < 20; ++i) {
+		int size = 1024 - i * 37;
+		m.generateRand(gen, size);
+		m.setBit(0, 1);
+		m.initModularReduction();
+		x.generateRand(gen, size);
+		x.mod(m);
+		y.generateRand(gen, size);
+		y.mod(m);
+
+		x.mulMont(y, m, check);
+		x.mulMontCIOS(y, m, ret);
+		assertMsg(ret.isEqual(check), "CIOS mont mul differs from bit-serial one.");
+
+		// result could be the same number as operand
+		x.mulMontCIOS(y, m, y);
+		assertMsg(y.isEqual(check), "CIOS mont mul to second operand differs.");
+		x.mulMontCIOS(x, m, ret);
+		x.mulMontCIOS(x, m, x);
+		assertMsg(x.isEqual(ret), "CIOS mont squaring in place differs.");
+		m.shutDownModularReduction();
+	}
+}
+
+void testMontgomeryDomain()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, x, y, xMont, yMont, res, check;
+	BigInt::Double prod;
+
+	for (int i = 0; i < 20; ++i) {
+		int size = 1024 - i * 41;
+		m.generateRand(gen, size);
+		m.setBit(0, 1);
+		BigInt::ModContext ctx(m);
+		x.generateRand(gen, size);
+		x.mod(ctx);
+		y.generateRand(gen, size);
+		y.mod(ctx);
+
+		x.toMont(ctx, xMont);
+		y.toMont(ctx, yMont);
+		xMont.fromMont(ctx, res);
+		assertMsg(res.isEqual(x), "Conversion from Montgomery form differs.");
+
+		x.mulMontCIOS(y, ctx, check);
+		xMont.montMul(yMont, ctx, res);
+		res.fromMont(ctx, res);
+		assertMsg(res.isEqual(check), "Product in Montgomery form differs.");
+
+		x.mulMontCIOS(x, ctx, check);
+		xMont.montSqr(ctx, res);
+		res.fromMont(ctx, res);
+		assertMsg(res.isEqual(check), "Square in Montgomery form differs.");
+
+		// REDC of full product is the same as Montgomery product
+		xMont.mul(yMont, prod);
+		BigInt::montRedc(prod, ctx, res);
+		xMont.montMul(yMont, ctx, check);
+		assertMsg(res.isEqual(check), "REDC of product differs.");
+	}
+}
+
+void testMultiplication()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt x, y, m, check, ret;
+	BigInt::Double res;
+	std::string numberStr;
+
+	x.setNumber(0x3FFFFFFF);
+	y.setNumber(3);
+	x.mul(y, ret);
+	check.fromString("BFFFFFFD");
+	assertMsg(ret.isEqual(check), "Fail mul in simple case.");
+
+	// (2^1024 - 1)^2 = 2^2048 - 2^1025 + 1
+	x.setMax();
+	x.mul(x, res);
+	numberStr.assign(255, 'F');
+	numberStr.push_back('E');
+	numberStr.append(255, '0');
+	numberStr.push_back('1');
+	assertStrMsg(res.toString(), numberStr, "Fail mul of max numbers.");
+
+	for (int i = 0; i < 20; ++i) {
+		int size = 1024 - i * 47;
+		m.generateRand(gen, size);
+		m.setBit(0, 1);
+		m.initModularReduction();
+		x.generateRand(gen, size);
+		x.mod(m);
+		y.generateRand(gen, size);
+		y.mod(m);
+
+		x.mulMontCIOS(y, m, check);
+		x.mul(y, res);
+		res.mod(m);
+		assertMsg(res.isEqual(check), "Product differs from Montgomery multiplication.");
+		m.shutDownModularReduction();
+	}
+}
+
+/*
+ * Product by shifts and additions, independent of block multiplication.
+ */
+static void mulByBits(const BigInt4096 &x, const BigInt4096 &y, BigInt4096::Double &res)
+{
+	BigInt4096::Double shifted;
+
+	shifted.copyContent(x);
+	res.setZero();
+	for (int i = 0; i <= y.getPosMostSignificatnBit(); ++i) {
+		if (y.getBit(i)) {
+			res.add(shifted);
+		}
+		shifted.shiftLeft(1);
+	}
+}
+
+void testKaratsubaThreshold()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	// lengths in blocks: schoolbook below threshold of 24 blocks,
+	// Karatsuba with even and odd halves above it
+	const unsigned int lengths[] = {1, 3, 22, 23, 24, 25, 26, 31, 47, 48, 49, 63, 64};
+	BigInt4096 x, y;
+	BigInt4096::Double res, check;
+
+	for (unsigned int blocks : lengths) {
+		const unsigned int bits = blocks * BIGINT_BLOCK_BITS;
+
+		for (int i = 0; i < 3; ++i) {
+			x.generateRand(gen, bits);
+			y.generateRand(gen, bits);
+			x.setBit(bits - 1, 1);
+			if (i == 1) {
+				// y is much shorter, upper halves are zero
+				y.generateRand(gen, BIGINT_BLOCK_BITS);
+			} else if (i == 2) {
+				// all ones carry through every block
+				x.setZero();
+				for (unsigned int j = 0; j < bits; ++j) {
+					x.setBit(j, 1);
+				}
+				y.copyContent(x);
+			}
+			x.mul(y, res);
+			mulByBits(x, y, check);
+			if (!res.isEqual(check)) {
+				LOG("Length of numbers {} blocks", blocks);
+			}
+			assertMsg(res.isEqual(check), "Product differs from reference.");
+			y.mul(x, res);
+			assertMsg(res.isEqual(check), "Product is not commutative.");
+		}
+	}
+}
+
+template <unsigned int Bits>
+void testFixedLength()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	FixedBigInt<Bits> x, y, m, a, b, ret, check;
+	typename FixedBigInt<Bits>::Double product;
+
+	m.generateRand(gen);
+	m.setBit(0, 1);
+	m.setBit(Bits - 1, 1);
+	m.initModularReduction();
+	x.generateRand(gen);
+	x.mod(m);
+	y.generateRand(gen);
+	y.mod(m);
+
+	x.mulMontCIOS(y, m, check);
+	x.mul(y, product);
+	product.mod(m);
+	assertMsg(product.isEqual(check), "Product differs from Montgomery multiplication.");
+
+	// x^a * x^b = x^(a + b)
+	a.generateRand(gen, Bits - 2);
+	b.generateRand(gen, Bits - 2);
+	x.exp(a, m, ret);
+	x.exp(b, m, check);
+	ret.mulMontCIOS(check, m, ret);
+	a.add(b);
+	x.exp(a, m, check);
+	assertMsg(ret.isEqual(check), "Exponentiation failed.");
+	m.shutDownModularReduction();
+}
+
 void testGetPosMostSignificatnBit()
 {
 	BigInt a;
@@ -468,6 +721,672 @@ void testExp()
 
 }
 
+void testExpWorkspace()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt::Workspace ws;
+	BigInt a, e, m, ret, check;
+
+	for (int i = 0; i < 10; ++i) {
+		int size = 1024 - i * 61;
+		m.generateRand(gen, size);
+		m.setBit(0, 1);
+		// module with table in workspace and exp with the same workspace
+		m.initModularReduction(ws);
+		a.generateRand(gen, size);
+		e.generateRand(gen, size);
+		a.exp(e, m, ret, ws);
+		m.shutDownModularReduction();
+
+		m.initModularReduction();
+		a.exp(e, m, check);
+		assertMsg(ret.isEqual(check), "Exp with workspace differs.");
+		a.mod(m, ws);
+		check.copyContent(a);
+		a.mod(m);
+		assertMsg(a.isEqual(check), "Mod with workspace differs.");
+		m.shutDownModularReduction();
+	}
+}
+
+/**
+ * @brief 			Naive left-to-right binary exponentiation.
+ */
+static void expBinary(const BigInt &x, const BigInt &e, const BigInt &m, BigInt &ret)
+{
+	BigInt base = x % m;
+
+	ret.setNumber(1);
+	for (int i = e.getPosMostSignificatnBit(); i >= 0; --i) {
+		ret = (ret * ret) % m;
+		if (e.getBit(i)) {
+			ret = (ret * base) % m;
+		}
+	}
+}
+
+void testSlidingWindowExp()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt::Workspace ws;
+	BigInt m, x, e, ret, check;
+	const unsigned int small[] = {0, 1, 2, 3, 5, 16, 255};
+
+	m.generateRand(gen, 1000);
+	m.setBit(0, 1);
+	x.generateRand(gen, 1020);
+	BigInt::ModContext ctx(m);
+
+	for (unsigned int value : small) {
+		e.setNumber(value);
+		x.exp(e, ctx, ret, ws);
+		expBinary(x, e, m, check);
+		assertMsg(ret.isEqual(check), "Exp by small exponent differs.");
+	}
+
+	// long runs of zeros between windows
+	e.setNumber(0);
+	e.setBit(1001, 1);
+	e.setBit(700, 1);
+	e.setBit(699, 1);
+	e.setBit(3, 1);
+	x.exp(e, ctx, ret, ws);
+	expBinary(x, e, m, check);
+	assertMsg(ret.isEqual(check), "Exp by sparse exponent differs.");
+
+	// lengths to cover every window size
+	for (int size = 8; size <= 1024; size *= 2) {
+		e.generateRand(gen, size);
+		BigInt::Exponent recoded(e);
+		x.exp(recoded, ctx, ret, ws);
+		expBinary(x, e, m, check);
+		assertMsg(ret.isEqual(check), "Sliding-window exp differs.");
+		// recoded exponent is reusable
+		x.generateRand(gen, 900);
+		x.exp(recoded, ctx, ret);
+		x.exp(e, ctx, check, ws);
+		assertMsg(ret.isEqual(check), "Exp by reused exponent differs.");
+	}
+}
+
+void testFixedBaseExp()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, x, e, ret, check;
+	const unsigned int teeth[] = {1, 4, 6, 8};
+
+	m.generateRand(gen, 1000);
+	m.setBit(0, 1);
+	x.generateRand(gen, 1020);
+	BigInt::ModContext ctx(m);
+
+	for (unsigned int t : teeth) {
+		BigInt::FixedBaseExp fixedBase(x, ctx, 1000, t);
+		assertMsg(fixedBase.getTableSize() == (1u << t), "Wrong size of table.");
+		e.setNumber(0);
+		fixedBase.exp(e, ret);
+		assertMsg(ret.cmp(1) == 0, "Fixed base exp by zero is not one.");
+		for (int size = 1; size <= 1000; size += 111) {
+			e.generateRand(gen, size);
+			fixedBase.exp(e, ret);
+			x.exp(e, ctx, check);
+			assertMsg(ret.isEqual(check), "Fixed base exp differs.");
+		}
+	}
+	// exponent longer than table
+	BigInt::FixedBaseExp shortTable(x, ctx, 100);
+	e.generateRand(gen, 500);
+	shortTable.exp(e, ret);
+	x.exp(e, ctx, check);
+	assertMsg(ret.isEqual(check), "Fixed base exp by long exponent differs.");
+}
+
+void testMontgomerySquaring()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, x, one, sqr, check;
+
+	one.setNumber(1);
+	for (int size = 64; size <= 1024; size += 96) {
+		m.generateRand(gen, size);
+		m.setBit(0, 1);
+		m.setBit(size - 1, 1);
+		BigInt::ModContext ctx(m);
+
+		for (int i = 0; i < 10; ++i) {
+			x.generateRand(gen, size);
+			x.mod(ctx);
+			// the largest number has all cross products
+			if (i == 0) {
+				x = m - one;
+			}
+			x.montSqr(ctx, sqr);
+			x.montMul(x, ctx, check);
+			assertMsg(sqr.isEqual(check), "Montgomery squaring differs.");
+			x.sqrMod(ctx, sqr);
+			x.mulMontCIOS(x, ctx, check);
+			assertMsg(sqr.isEqual(check), "Squaring by module differs.");
+			x.montSqr(ctx, sqr);
+			x.montSqr(ctx, x);
+			assertMsg(x.isEqual(sqr), "Montgomery squaring in place differs.");
+		}
+	}
+}
+
+/**
+ * @brief 			Digits of 52 bits of number, see MontMul52.
+ */
+static std::vector<uint64_t> toDigits52(const BigInt &x, unsigned int digits)
+{
+	std::vector<uint64_t> res(MONT52_STRIDE(digits), 0);
+
+	for (int i = x.getPosMostSignificatnBit(); i >= 0; --i) {
+		res[i / MONT52_DIGIT_BITS] |= (uint64_t)x.getBit(i) << (i % MONT52_DIGIT_BITS);
+	}
+	return res;
+}
+
+void testMontKernels52()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, a, b, check, radix, one;
+	const unsigned int lengths[] = {512, 1024};
+
+	one.setNumber(1);
+	for (unsigned int bits : lengths) {
+		const MontKernel52 *scalar = getScalarMontKernel52(bits);
+		const MontKernel52 *simd = getMontKernel52(bits);
+		if (scalar == NULL) {
+			LOG("No kernels of radix 2^52 on this compiler.");
+			return;
+		}
+		if (simd == NULL) {
+			LOG("Vectorized kernel for {} bits is not supported by CPU.", bits);
+		}
+		const unsigned int digits = scalar->digits;
+
+		m.generateRand(gen, bits);
+		m.setBit(0, 1);
+		m.setBit(bits - 1, 1);
+		m.initModularReduction();
+		std::vector<uint64_t> md = toDigits52(m, digits);
+		uint64_t k0 = md[0];
+		for (int i = 0; i < 6; ++i) {
+			k0 *= 2 - md[0] * k0;
+		}
+		k0 = (0 - k0) & MONT52_DIGIT_MASK;
+		// R mod m for R = 2^(52 * digits)
+		BigInt::Double r;
+		r.setBit(MONT52_DIGIT_BITS * digits, 1);
+		radix = r % m;
+
+		for (int i = 0; i < 20; ++i) {
+			a.generateRand(gen, bits);
+			b.generateRand(gen, bits);
+			a = a % m;
+			b = b % m;
+			if (i == 0) {
+				a = m - one;
+				b = m - one;
+			}
+			std::vector<uint64_t> ad = toDigits52(a, digits);
+			std::vector<uint64_t> bd = toDigits52(b, digits);
+			std::vector<uint64_t> res(ad.size()), simdRes(ad.size());
+
+			// res * R = a * b mod m
+			scalar->mul(res.data(), ad.data(), bd.data(), md.data(), k0);
+			check.setZero();
+			for (unsigned int j = 0; j < bits; ++j) {
+				check.setBit(j, (res[j / MONT52_DIGIT_BITS] >> (j % MONT52_DIGIT_BITS)) & 1);
+			}
+			assertMsg(((check * radix) % m).isEqual((a * b) % m),
+				  "Scalar kernel of radix 2^52 is wrong.");
+			if (simd) {
+				simd->mul(simdRes.data(), ad.data(), bd.data(), md.data(), k0);
+				assertMsg(simdRes == res, "Vectorized multiplication differs.");
+				scalar->sqr(res.data(), ad.data(), ad.data(), md.data(), k0);
+				simd->sqr(simdRes.data(), ad.data(), ad.data(), md.data(), k0);
+				assertMsg(simdRes == res, "Vectorized squaring differs.");
+			}
+		}
+		m.shutDownModularReduction();
+
+		// exponentiation by kernel and by blocks
+		BigInt::Workspace ws;
+		a.generateRand(gen, bits);
+		b.generateRand(gen, bits);
+		setMontKernels52Enabled(false);
+		BigInt::ModContext scalarCtx(m);
+		setMontKernels52Enabled(true);
+		BigInt::ModContext ctx(m);
+		a.exp(b, scalarCtx, check, ws);
+		a.exp(b, ctx, one, ws);
+		assertMsg(one.isEqual(check), "Exponentiation by kernel differs.");
+		one.setNumber(1);
+	}
+}
+
+void testBatch()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, x, y, e, check, res;
+	const int lengths[] = {1024, 500};
+	const unsigned int count = 37;
+
+	for (int bits : lengths) {
+		m.generateRand(gen, bits);
+		m.setBit(0, 1);
+		BigInt::ModContext ctx(m);
+		BigInt::Batch a(ctx, count), b(ctx, count), ret(ctx, count);
+		std::vector<BigInt> xs(count), ys(count);
+
+		assertMsg(a.size() == count, "Wrong size of batch.");
+		for (unsigned int i = 0; i < count; ++i) {
+			xs[i].generateRand(gen, bits);
+			ys[i].generateRand(gen, bits);
+			a.set(i, xs[i]);
+			b.set(i, ys[i]);
+			xs[i].mod(ctx);
+			ys[i].mod(ctx);
+			a.get(i, check);
+			assertMsg(check.isEqual(xs[i]), "Number of batch differs.");
+		}
+
+		a.mulMont(b, ret);
+		for (unsigned int i = 0; i < count; ++i) {
+			ret.get(i, res);
+			xs[i].mulMontCIOS(ys[i], ctx, check);
+			assertMsg(res.isEqual(check), "Batch multiplication differs.");
+		}
+
+		e.generateRand(gen, bits);
+		a.exp(e, ret);
+		for (unsigned int i = 0; i < count; ++i) {
+			ret.get(i, res);
+			xs[i].exp(e, ctx, check);
+			assertMsg(res.isEqual(check), "Batch exponentiation differs.");
+		}
+		// by blocks without vectorized kernel
+		setMontKernels52Enabled(false);
+		a.exp(e, b);
+		for (unsigned int i = 0; i < count; ++i) {
+			ret.get(i, check);
+			b.get(i, res);
+			assertMsg(res.isEqual(check), "Batch exponentiation by blocks differs.");
+		}
+		a.mulMont(b, b);
+		setMontKernels52Enabled(true);
+		for (unsigned int i = 0; i < count; ++i) {
+			ret.get(i, y);
+			xs[i].mulMontCIOS(y, ctx, check);
+			b.get(i, res);
+			assertMsg(res.isEqual(check), "Batch multiplication by blocks differs.");
+		}
+
+		// in place, by zero exponent
+		e.setZero();
+		a.exp(e, a);
+		a.get(count - 1, res);
+		assertMsg(res.cmp(1) == 0, "Batch exponentiation by zero is not one.");
+	}
+}
+
+void testModInverse()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, a, inv, check, three;
+
+	three.setNumber(3);
+	for (int size = 8; size <= 1024; size += 61) {
+		m.generateRand(gen, size);
+		m.setBit(0, 1);
+		m.initModularReduction();
+		for (int i = 0; i < 5; ++i) {
+			a.generateRand(gen, i == 0 ? 1024 : size);
+			a.gcd(m, check);
+			if (a.modInverse(m, inv)) {
+				assertMsg(check.cmp(1) == 0, "Inverse exists for not coprime number.");
+				assertMsg(inv.cmp(m) == -1, "Inverse is not reduced.");
+				a = a % m;
+				a.mulMontCIOS(inv, m, check);
+				assertMsg(check.cmp(1) == 0, "a * a^(-1) is not one.");
+			} else {
+				assertMsg(check.cmp(1) != 0, "Inverse of coprime number is not found.");
+			}
+		}
+		m.shutDownModularReduction();
+	}
+
+	// not coprime and trivial numbers
+	m.setNumber(3 * 5 * 7 * 11);
+	assertMsg(three.modInverse(m, inv) == false, "Inverse of divisor of module.");
+	a.setZero();
+	assertMsg(a.modInverse(m, inv) == false, "Inverse of zero.");
+	a.setNumber(1);
+	assertMsg(a.modInverse(m, inv) && inv.cmp(1) == 0, "Inverse of one is not one.");
+	a.setNumber(2);
+	assertMsg(a.modInverse(m, inv) && inv.cmp(578) == 0, "Inverse of two is wrong.");
+}
+
+/**
+ * @brief 			Jacobi symbol of small numbers by reciprocity.
+ */
+static int jacobiSmall(unsigned int a, unsigned int n)
+{
+	int t = 1;
+
+	a %= n;
+	while (a != 0) {
+		while (a % 2 == 0) {
+			a /= 2;
+			if (n % 8 == 3 || n % 8 == 5) {
+				t = -t;
+			}
+		}
+		std::swap(a, n);
+		if (a % 4 == 3 && n % 4 == 3) {
+			t = -t;
+		}
+		a %= n;
+	}
+	return n == 1 ? t : 0;
+}
+
+void testJacobi()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt a, n, m, e, res, one;
+	BigInt::Double prod;
+
+	for (unsigned int i = 1; i < 300; i += 2) {
+		n.setNumber(i);
+		for (unsigned int j = 0; j < 300; ++j) {
+			a.setNumber(j);
+			assertMsg(a.jacobi(n) == jacobiSmall(j, i), "Jacobi symbol of small numbers.");
+		}
+	}
+
+	// Euler criterion for prime 2^521 - 1
+	one.setNumber(1);
+	for (unsigned int i = 0; i < 521; ++i) {
+		n.setBit(i, 1);
+	}
+	e = n;
+	e.shiftRightBit();
+	n.initModularReduction();
+	for (int i = 0; i < 20; ++i) {
+		a.generateRand(gen, 256 + 13 * i);
+		a.exp(e, n, res);
+		assertMsg(a.jacobi(n) == (res.isEqual(one) ? 1 : -1), "Legendre symbol differs from Euler criterion.");
+	}
+	n.shutDownModularReduction();
+
+	// multiplicativity by module
+	for (int i = 0; i < 20; ++i) {
+		n.generateRand(gen, 500);
+		n.setBit(0, 1);
+		m.generateRand(gen, 500);
+		m.setBit(0, 1);
+		a.generateRand(gen, 1000);
+		prod = n * m;
+		assertMsg(a.jacobi(BigInt(prod)) == a.jacobi(n) * a.jacobi(m), "Jacobi symbol is not multiplicative.");
+	}
+}
+
+/*
+ * Primes of 512 bits congruent to 3 modulo 4 for Rabin keys.
+ */
+static const char *rabinP = "EBE0E87F7DCB4484493BF4DCDC165096068F7CEC5542050CDB704F615E3B91C9"
+			    "2235300A3854B0E9C68E150B5E1403E8CC5DD264B4CD973FAF7DC92BF9A23D07";
+static const char *rabinQ = "FC623BC1A04E3C7120F90E70A0A69032275ECB6AEBD66C46CFCF9098E64738AA"
+			    "200075713FF93A42F9479EA2DB79891436D348FAC3B7E75233923D4C846052EF";
+
+/*
+ * H = SHA256(message || R) of signature.
+ */
+static void rabinHash(const ESRabinSignature &signature, BigInt &H)
+{
+	std::vector<uint8_t> bytes(signature.getMessage().begin(), signature.getMessage().end());
+	std::vector<uint8_t> byteArray = signature.getR().getByteArray();
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	unsigned int size;
+
+	bytes.insert(bytes.end(), byteArray.begin(), byteArray.end());
+	EVP_Digest(bytes.data(), bytes.size(), digest, &size, EVP_sha256(), NULL);
+	H.fromByteArray(digest, size);
+}
+
+void testRabinLoadKeys()
+{
+	RandomGeneratorMush gen(2020, 0);
+	ESRabinManager manager(gen, 1);
+	ESRabinPublicKey pubKey;
+	ESRabinPrivateKey privKey;
+	ESRabinSignature signature;
+	BigInt p(rabinP), q(rabinQ), n, H, e, one, two, root, res;
+
+	assertMsg(manager.loadKeys(p, q, pubKey, privKey), "Known primes are rejected.");
+	n = BigInt(p * q);
+	assertMsg(pubKey.getN().isEqual(n), "Module is not product of primes.");
+	assertMsg(privKey.getP().isEqual(p) && privKey.getQ().isEqual(q), "Wrong primes of key.");
+
+	one.setNumber(1);
+	two.setNumber(2);
+	n.initModularReduction();
+	p.initModularReduction();
+	q.initModularReduction();
+	for (int i = 0; i < 10; ++i) {
+		manager.signMessage("message " + std::to_string(i), signature, pubKey, privKey);
+		rabinHash(signature, H);
+		assertMsg(signature.getB().cmp(n) == -1, "B is not less than module.");
+
+		// CRT result has roots of H by p and q as residues
+		e = p + one;
+		e.shiftRightBlock(2);
+		H.exp(e, p, root);
+		res = signature.getB() % p;
+		assertMsg(res.isEqual(root), "B mod p is not root of H by p.");
+		e = q + one;
+		e.shiftRightBlock(2);
+		H.exp(e, q, root);
+		res = signature.getB() % q;
+		assertMsg(res.isEqual(root), "B mod q is not root of H by q.");
+
+		// direct square by module n
+		signature.getB().exp(two, n, res);
+		assertMsg(res.isEqual(H), "B^2 mod n is not H.");
+		assertMsg(manager.checkSignature(signature, pubKey), "Signature is wrong.");
+	}
+	n.shutDownModularReduction();
+	p.shutDownModularReduction();
+	q.shutDownModularReduction();
+	manager.finalizeKeys(pubKey, privKey);
+}
+
+void testRabinNonResidue()
+{
+	RandomGeneratorMush gen(2021, 0);
+	ESRabinManager manager(gen, 1);
+	ESRabinPublicKey pubKey;
+	ESRabinPrivateKey privKey;
+	ESRabinSignature signature;
+	BigInt p(rabinP), q(rabinQ), h, e, one, root, square;
+	BigInt::Double prod;
+	unsigned int i;
+
+	assertMsg(manager.loadKeys(p, q, pubKey, privKey), "Known primes are rejected.");
+	// signing takes only H which are residues by both primes
+	for (i = 0; i < 10; ++i) {
+		manager.signMessage("residue " + std::to_string(i), signature, pubKey, privKey);
+		rabinHash(signature, h);
+		assertMsg(h.jacobi(p) == 1 && h.jacobi(q) == 1, "H of signature is not residue.");
+	}
+
+	// formula of square root gives no root for non-residue
+	one.setNumber(1);
+	e = p + one;
+	e.shiftRightBlock(2);
+	p.initModularReduction();
+	for (i = 2; i < 100; ++i) {
+		h.setNumber(i);
+		if (h.jacobi(p) != -1) {
+			continue;
+		}
+		h.exp(e, p, root);
+		prod = root * root;
+		square = prod % p;
+		assertMsg(!square.isEqual(h), "Non-residue has square root.");
+		break;
+	}
+	assertMsg(i < 100, "Non-residue is not found.");
+	// the same formula works for residue i^2
+	h.setNumber(i * i);
+	h.exp(e, p, root);
+	prod = root * root;
+	square = prod % p;
+	assertMsg(square.isEqual(h), "Residue has no square root.");
+	p.shutDownModularReduction();
+	manager.finalizeKeys(pubKey, privKey);
+}
+
+void testRabinBadKeys()
+{
+	RandomGeneratorMush gen(2022, 0);
+	ESRabinManager manager(gen, 1);
+	ESRabinPublicKey pubKey;
+	ESRabinPrivateKey privKey;
+	BigInt p(rabinP), q(rabinQ), bad, one;
+
+	one.setNumber(1);
+	assertMsg(manager.loadKeys(p, q, pubKey, privKey), "Good primes are rejected.");
+
+	// p = 1 mod 4 has no root exponent (p + 1) / 4
+	bad.setNumber(13);
+	assertMsg(!manager.loadKeys(bad, q, pubKey, privKey), "Prime 1 mod 4 is accepted.");
+	assertMsg(!manager.loadKeys(p, bad, pubKey, privKey), "Prime 1 mod 4 is accepted.");
+	// even number
+	bad = p + one;
+	assertMsg(!manager.loadKeys(bad, q, pubKey, privKey), "Even number is accepted.");
+	// equal primes and common factor have no CRT coefficient
+	assertMsg(!manager.loadKeys(p, p, pubKey, privKey), "Equal primes are accepted.");
+	bad.setNumber(5);
+	bad = BigInt(p * bad);
+	assertMsg(!manager.loadKeys(p, bad, pubKey, privKey), "Common factor is accepted.");
+	// product is longer than module
+	bad.setZero();
+	bad.setBit(700, 1);
+	bad.setBit(1, 1);
+	bad.setBit(0, 1);
+	assertMsg(!manager.loadKeys(p, bad, pubKey, privKey), "Too long product is accepted.");
+
+	// keys of rejected primes are not changed
+	assertMsg(privKey.getP().isEqual(p) && privKey.getQ().isEqual(q),
+		  "Rejected primes changed key.");
+	assertMsg(pubKey.getN().isEqual(BigInt(p * q)), "Rejected primes changed module.");
+	manager.finalizeKeys(pubKey, privKey);
+}
+
+void testModContext()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt m, x, y, e, check, ret[2];
+	BigInt::Double prod;
+
+	m.generateRand(gen, 1000);
+	m.setBit(0, 1);
+	x.generateRand(gen, 900);
+	y.generateRand(gen, 900);
+	e.generateRand(gen, 1000);
+
+	m.initModularReduction();
+	x.exp(e, m, check);
+	m.shutDownModularReduction();
+
+	std::shared_ptr<const BigInt::ModContext> ctx = BigInt::ModContext::create(m);
+	// context keeps its own copy of module
+	m.setZero();
+	assertMsg(ctx->getModule().isZero() == false, "Context depends on module number.");
+
+	// one context is used by several threads
+	std::thread threads[2];
+	for (int i = 0; i < 2; ++i) {
+		threads[i] = std::thread([&, i] { x.exp(e, *ctx, ret[i]); });
+	}
+	for (int i = 0; i < 2; ++i) {
+		threads[i].join();
+		assertMsg(ret[i].isEqual(check), "Exp with shared context differs.");
+	}
+
+	x.mul(y, prod);
+	prod.mod(*ctx);
+	x.mulMontCIOS(y, *ctx, ret[0]);
+	assertMsg(ret[0].isEqual(prod), "Mod and CIOS with context differ.");
+}
+
+void testValueSemantics()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt a, b, m, check;
+
+	a.generateRand(gen, 1000);
+	b.generateRand(gen, 1000);
+
+	BigInt c(a);
+	assertMsg(c.isEqual(a), "Copy constructor differs.");
+	c = b;
+	assertMsg(c.isEqual(b), "Copy assignment differs.");
+
+	check.copyContent(a);
+	check.add(b);
+	assertMsg((a + b).isEqual(check), "Operator + differs from add.");
+	assertMsg((a + b - b).isEqual(a), "Operator - differs from sub.");
+
+	BigInt::Double prod;
+	a.mul(b, prod);
+	assertMsg((a * b).isEqual(prod), "Operator * differs from mul.");
+
+	m.generateRand(gen, 900);
+	m.setBit(0, 1);
+	// remainder by division, then by pre-computed table
+	BigInt r = a % m;
+	BigInt q;
+	check.setZero();
+	a.div(m, q, check);
+	assertMsg(r.isEqual(check), "Operator % differs from div.");
+
+	m.initModularReduction();
+	r = a % m;
+	assertMsg(r.isEqual(check), "Operator % with table differs from div.");
+	a.mod(m);
+	b.mod(m);
+	a.mulMontCIOS(b, m, check);
+	assertMsg((a * b % m).isEqual(check), "Product modulo differs from CIOS.");
+
+	// moved module keeps its table
+	BigInt moved(std::move(m));
+	a.mulMontCIOS(b, moved, r);
+	assertMsg(r.isEqual(check), "Moved module lost its table.");
+	m = std::move(moved);
+	a.mulMontCIOS(b, m, r);
+	assertMsg(r.isEqual(check), "Move assignment lost table.");
+	m.shutDownModularReduction();
+
+	// multiples of module, with table and without it
+	for (unsigned int k = 1; k < 6; ++k) {
+		BigInt km;
+		km.setNumber(k);
+		BigInt::Double multiple = m * km;
+		assertMsg((multiple % m).isZero(), "Multiple of module is not zero.");
+		m.initModularReduction();
+		assertMsg((multiple % m).isZero(), "Multiple of module with table is not zero.");
+		if (k < 3) {
+			BigInt single(multiple);
+			assertMsg((single % m).isZero(), "Short multiple of module is not zero.");
+		}
+		m.shutDownModularReduction();
+	}
+}
+
 void testDivision()
 {
 	BigInt x, y, q, r, q_check, r_check;
@@ -494,6 +1413,63 @@ void testDivision()
 	assertMsg(q.isEqual(q_check), "R was wrong.");
 }
 
+void testDivisionRandom()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt x, y, q, r;
+	BigInt::Double check, rest;
+
+	for (int i = 0; i < 200; ++i) {
+		x.generateRand(gen, 1024 - i % 7);
+		y.generateRand(gen, 1 + (i * 37) % 1024);
+		if (y.isZero()) {
+			continue;
+		}
+		if (i % 5 == 0) {
+			// divisor with many ones makes estimation of quotient wrong
+			y.setMax();
+			y.shiftRight(i * 5);
+			y.setBit(0, 0);
+		}
+		assertMsg(x.div(y, q, r), "Operation was not executed.");
+		assertMsg(r.cmp(y) == -1, "Remainder is not less than divisor.");
+		q.mul(y, check);
+		rest.setZero();
+		rest.copyContent(r);
+		check.add(rest);
+		assertMsg(check.isEqual(x), "q * y + r differs from x.");
+	}
+
+	// y is one block
+	x.setMax();
+	y.setNumber(257);
+	x.div(y, q, r);
+	assertMsg(r.isZero(), "2^1024 - 1 should be divisible by 257.");
+}
+
+void testDivisionByWord()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt x, y, q, r, q_check;
+	block d, rem;
+
+	for (int i = 0; i < 100; ++i) {
+		x.generateRand(gen, 1024 - i);
+		// divisor fits to block of any size
+		d = (gen.next32bit() >> 2) | 1;
+		y.setNumber(d);
+		x.div(y, q_check, r);
+
+		rem = x.divmodWord(d, q);
+		assertMsg(q.isEqual(q_check), "Quotient by word differs from div.");
+		assertMsg(r.cmp(rem) == 0, "Remainder by word differs from div.");
+		assertMsg(x.modWord(d) == rem, "modWord differs from divmodWord.");
+
+		x.divmodWord(d, x);
+		assertMsg(x.isEqual(q_check), "Quotient to the same number differs.");
+	}
+}
+
 void testGenerator()
 {
 	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
@@ -502,6 +1478,111 @@ void testGenerator()
 	assertMsg(a.isZero() == false, "Number is zero");
 }
 
+/*
+ * Mush generator by definition: arrays are shifted on every step.
+ */
+class ReferenceMush {
+public:
+	/*
+	 * The same expansion of seed as in seeded RandomGeneratorMush.
+	 */
+	ReferenceMush(uint64_t seed, uint64_t stream) : overflowA(false), overflowB(false)
+	{
+		uint64_t state = seed ^ splitMix64(stream);
+
+		for (unsigned int &a : A) {
+			a = splitMix64(state) >> 32;
+		}
+		for (unsigned int &b : B) {
+			b = splitMix64(state) >> 32;
+		}
+	}
+	unsigned int next32bit()
+	{
+		if (overflowA) {
+			step(B, 19, overflowB);
+		}
+		if (overflowB) {
+			step(A, 24, overflowA);
+		}
+		step(A, 24, overflowA);
+		step(B, 19, overflowB);
+		return A.back() ^ B.back();
+	}
+private:
+	template <size_t N>
+	static void step(std::array<unsigned int, N> &X, size_t lag, bool &overflow)
+	{
+		uint64_t x = (uint64_t)X[0] + (uint64_t)X[N - lag];
+
+		overflow = x > UINT_MAX;
+		for (size_t i = 0; i < N - 1; ++i) {
+			X[i] = X[i + 1];
+		}
+		X[N - 1] = x;
+	}
+
+	std::array<unsigned int, 55> A;
+	std::array<unsigned int, 52> B;
+	bool overflowA;
+	bool overflowB;
+};
+
+void testGeneratorSequence()
+{
+	RandomGeneratorMush gen(2017, 3);
+	ReferenceMush reference(2017, 3);
+	std::vector<uint32_t> words(1000);
+
+	for (int i = 0; i < 1000; ++i) {
+		assertEqualMsg(gen.next32bit(), reference.next32bit(), "Wrong number of generator.");
+	}
+	// bulk and single numbers continue the same sequence
+	for (int round = 0; round < 3; ++round) {
+		gen.fill(words.data(), words.size() - round);
+		for (size_t i = 0; i < words.size() - round; ++i) {
+			assertEqualMsg(words[i], reference.next32bit(), "Wrong number of bulk generation.");
+		}
+	}
+}
+
+void testGeneratorStreams()
+{
+	RandomGeneratorStreams streams(42), sameStreams(42);
+	RandomGeneratorMush gen(42, 1);
+	std::unique_ptr<RandomGeneratorMush> first = streams.split();
+	std::unique_ptr<RandomGeneratorMush> second = streams.split();
+	std::unique_ptr<RandomGeneratorMush> again = sameStreams.create(1);
+	unsigned int x;
+	int equal = 0;
+
+	assertEqualMsg(streams.getMasterSeed(), 42u, "Wrong master seed.");
+	for (int i = 0; i < 1000; ++i) {
+		x = second->next32bit();
+		assertEqualMsg(x, gen.next32bit(), "Stream differs from seeded generator.");
+		assertEqualMsg(x, again->next32bit(), "Stream is not reproducible.");
+		equal += first->next32bit() == x;
+	}
+	assertMsg(equal < 10, "Streams are not independent.");
+}
+
+void benchGenerator()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	const size_t count = 1 << 22;
+	std::vector<uint32_t> words(1024);
+	std::clock_t begin = std::clock();
+	uint32_t sum = 0;
+
+	for (size_t i = 0; i < count; i += words.size()) {
+		gen.fill(words.data(), words.size());
+		sum ^= words[0];
+	}
+	double seconds = double(std::clock() - begin) / CLOCKS_PER_SEC;
+	INFO(PAINT("Generator Mush: {:.1f} MB/s ({})", YELLOW),
+	     count * 4 / seconds / (1 << 20), sum);
+}
+
 void testGcd()
 {
 	BigInt x, y, res, check;
@@ -552,6 +1633,249 @@ void testPrimeGenerator()
 	}
 }
 
+void testPrimeSearch()
+{
+	RandomGenerator& gen = RandomGeneratorMush::getGeneratorMush();
+	BigInt512::Workspace ws;
+	BigInt512 p, r, s, n, e, a, ret;
+	BigInt512::Double check;
+
+	p.generatePrime(gen, ws);
+	assertMsg(p.isEven() == false, "Prime is even.");
+
+	// Fermat test for several bases
+	e.copyContent(p);
+	a.setNumber(1);
+	e.sub(a);
+	p.initModularReduction();
+	for (unsigned int base = 2; base < 12; ++base) {
+		a.setNumber(base);
+		a.exp(e, p, ret);
+		assertMsg(ret.cmp(1) == 0, "Found number is not prime.");
+	}
+	p.shutDownModularReduction();
+
+	// Miller-Rabin by vectorized kernel and by blocks finds the same prime
+	SeededGenerator kernelGen(777), blockGen(777);
+	r.generatePrime(kernelGen, ws);
+	setMontKernels52Enabled(false);
+	s.generatePrime(blockGen, ws);
+	setMontKernels52Enabled(true);
+	assertMsg(r.isEqual(s), "Prime search depends on kernel.");
+
+	n.generateBlumPrime(gen, r, s, ws);
+	assertMsg(r.modWord(4) == 3 && s.modWord(4) == 3, "Part of Blum number is not 3 mod 4.");
+	assertMsg(r.getPosMostSignificatnBit() < 256, "Part of Blum number is too long.");
+	r.mul(s, check);
+	assertMsg(check.isEqual(n), "Blum number is not product of its parts.");
+}
+
+void testParallelBlumPrime()
+{
+	ThreadPool onePool(1), fourPool(4);
+	BigInt512 n, r, s, n2, r2, s2;
+	BigInt512::Double check;
+	SeededGenerator gen(12345), gen2(12345);
+
+	n.generateBlumPrime(gen, r, s, fourPool);
+	assertMsg(r.modWord(4) == 3 && s.modWord(4) == 3, "Part of Blum number is not 3 mod 4.");
+	assertMsg(r.getPosMostSignificatnBit() < 256, "Part of Blum number is too long.");
+	r.mul(s, check);
+	assertMsg(check.isEqual(n), "Blum number is not product of its parts.");
+
+	// the same generator gives the same number for any amount of threads
+	n2.generateBlumPrime(gen2, r2, s2, onePool);
+	assertMsg(r2.isEqual(r) && s2.isEqual(s), "Parallel search is not reproducible.");
+
+	// many searches one after another on the same small pool
+	ThreadPool twoPool(2);
+	for (int i = 0; i < 30; ++i) {
+		n.generateBlumPrime(gen, r, s, twoPool);
+		assertMsg(r.modWord(4) == 3 && s.modWord(4) == 3, "Part of Blum number is not 3 mod 4.");
+		r.mul(s, check);
+		assertMsg(check.isEqual(n), "Blum number is not product of its parts.");
+	}
+}
+
+void testThreadPool()
+{
+	ThreadPool pool(2);
+	std::vector<std::atomic<int>> done(64);
+	bool thrown = false;
+
+	assertEqualMsg(pool.size(), 2u, "Wrong size of pool.");
+	// runs back to back, workers of previous run are still busy
+	for (int run = 0; run < 5000; ++run) {
+		size_t count = 1 + run % 9;
+
+		for (size_t i = 0; i < count; ++i) {
+			done[i] = 0;
+		}
+		pool.run(count, [&](unsigned int worker, size_t i) {
+			assertMsg(worker < 2, "Wrong index of worker.");
+			++done[i];
+		});
+		for (size_t i = 0; i < count; ++i) {
+			assertEqualMsg(done[i].load(), 1, "Item is not run exactly once.");
+		}
+	}
+
+	try {
+		pool.run(10, [](unsigned int, size_t i) {
+			if (i == 7) {
+				throw std::runtime_error("task failed");
+			}
+		});
+	} catch (const std::runtime_error &) {
+		thrown = true;
+	}
+	assertMsg(thrown, "Exception of task is not rethrown.");
+	pool.run(3, [&](unsigned int, size_t i) { done[i] = 2; });
+	assertMsg(done[2] == 2, "Pool does not work after exception.");
+	// nested run from task is executed by the same worker
+	std::atomic<unsigned int> nested(0);
+	pool.run(8, [&](unsigned int outer, size_t) {
+		pool.run(4, [&](unsigned int inner, size_t) {
+			assertMsg(inner == outer, "Nested run changed worker.");
+			++nested;
+		});
+	});
+	assertEqualMsg(nested.load(), 32u, "Nested run lost items.");
+}
+
+void testSignMessages()
+{
+	RandomGeneratorMush gen(2017, 0);
+	ESRabinManager manager(gen, 3);
+	ESRabinPublicKey pubKey;
+	ESRabinPrivateKey privKey;
+	std::vector<std::string> messages;
+	std::vector<ESRabinSignature> signatures;
+
+	manager.generateKeys(pubKey, privKey);
+	for (int i = 0; i < 40; ++i) {
+		messages.push_back("message " + std::to_string(i));
+	}
+	manager.signMessages(messages, signatures, pubKey, privKey);
+	assertEqualMsg(signatures.size(), messages.size(), "Wrong count of signatures.");
+	for (size_t i = 0; i < messages.size(); ++i) {
+		assertStrMsg(signatures[i].getMessage(), messages[i], "Signatures are not in order of messages.");
+		assertMsg(manager.checkSignature(signatures[i], pubKey), "Signature is wrong.");
+	}
+	manager.finalizeKeys(pubKey, privKey);
+}
+
+void testHashMidstate()
+{
+	const EVP_MD *md = EVP_sha256();
+	std::string prefixData(1000, 'p');
+	std::string tail("tail of message");
+	std::string whole = prefixData + tail;
+	unsigned char digest[EVP_MAX_MD_SIZE], oneShot[EVP_MAX_MD_SIZE];
+	unsigned int size, oneShotSize;
+	HashContext prefix, hash;
+
+	EVP_Digest(whole.data(), whole.size(), oneShot, &oneShotSize, md, NULL);
+
+	prefix.init(md);
+	prefix.update(prefixData.data(), prefixData.size());
+	// midstate is copied several times and prefix stays unchanged
+	for (int i = 0; i < 3; ++i) {
+		hash.copyFrom(prefix);
+		hash.update(tail.data(), tail.size());
+		size = hash.final(digest);
+		assertEqualMsg(size, oneShotSize, "Wrong size of digest.");
+		assertMsg(memcmp(digest, oneShot, size) == 0, "Digest of midstate differs from one-shot digest.");
+	}
+
+	// reused context gives digest of new data only
+	hash.init(md);
+	hash.update(whole.data(), whole.size());
+	size = hash.final(digest);
+	assertMsg(memcmp(digest, oneShot, size) == 0, "Digest of reused context is wrong.");
+}
+
+void testSignRoundTrip()
+{
+	RandomGeneratorMush gen(2019, 0);
+	ESRabinManager manager(gen, 1);
+	ESRabinPublicKey pubKey;
+	ESRabinPrivateKey privKey;
+	ESRabinSignature signature;
+	std::vector<std::string> messages = {"", "short", std::string(100000, 'm')};
+
+	manager.generateKeys(pubKey, privKey);
+	for (const std::string &message : messages) {
+		manager.signMessage(message, signature, pubKey, privKey);
+		assertStrMsg(signature.getMessage(), message, "Wrong message of signature.");
+		assertMsg(manager.checkSignature(signature, pubKey), "Signature is wrong.");
+		assertMsg(!manager.checkSignature(ESRabinSignature(message + "x", signature.getR(),
+								   signature.getB()), pubKey),
+			  "Signature of other message is correct.");
+	}
+	manager.finalizeKeys(pubKey, privKey);
+}
+
+void testCheckSignatures()
+{
+	RandomGeneratorMush gen(2018, 0);
+	ESRabinManager manager(gen, 2);
+	ESRabinPublicKey pubKey, otherPubKey;
+	ESRabinPrivateKey privKey, otherPrivKey;
+	std::vector<std::string> messages = {"first", "second", "third"};
+	std::vector<ESRabinSignature> signatures, otherSignatures, batch;
+	std::vector<bool> expected, result;
+
+	manager.generateKeys(pubKey, privKey);
+	manager.generateKeys(otherPubKey, otherPrivKey);
+	manager.signMessages(messages, signatures, pubKey, privKey);
+	manager.signMessages(messages, otherSignatures, otherPubKey, otherPrivKey);
+
+	const ESRabinSignature &a = signatures[0];
+	const ESRabinSignature &b = signatures[1];
+
+	batch.push_back(a);
+	expected.push_back(true);
+	// tampered message, R and B
+	batch.push_back(ESRabinSignature(a.getMessage() + "!", a.getR(), a.getB()));
+	expected.push_back(false);
+	batch.push_back(ESRabinSignature(a.getMessage(), b.getR(), a.getB()));
+	expected.push_back(false);
+	batch.push_back(ESRabinSignature(a.getMessage(), a.getR(), b.getB()));
+	expected.push_back(false);
+	batch.push_back(b);
+	expected.push_back(true);
+	// B out of range of module
+	batch.push_back(ESRabinSignature(a.getMessage(), a.getR(), pubKey.getN()));
+	expected.push_back(false);
+	// signature by other key
+	batch.push_back(otherSignatures[2]);
+	expected.push_back(false);
+	batch.push_back(signatures[2]);
+	expected.push_back(true);
+
+	result = manager.checkSignatures(batch, pubKey);
+	assertEqualMsg(result.size(), batch.size(), "Wrong count of results.");
+	for (size_t i = 0; i < batch.size(); ++i) {
+		assertMsg(result[i] == expected[i], "Wrong result of check.");
+		assertMsg(manager.checkSignature(batch[i], pubKey) == expected[i],
+			  "Single check differs from batch check.");
+	}
+	assertMsg(manager.checkSignatures(std::vector<ESRabinSignature>(), pubKey).empty(),
+		  "Result for empty batch is not empty.");
+
+	// key which is not generated or already finalized
+	ESRabinPublicKey emptyKey;
+	assertMsg(!manager.checkSignature(a, emptyKey), "Empty key accepts signature.");
+	result = manager.checkSignatures(batch, emptyKey);
+	for (size_t i = 0; i < batch.size(); ++i) {
+		assertMsg(!result[i], "Empty key accepts signature of batch.");
+	}
+	manager.finalizeKeys(pubKey, privKey);
+	manager.finalizeKeys(otherPubKey, otherPrivKey);
+	assertMsg(!manager.checkSignature(a, pubKey), "Finalized key accepts signature.");
+}
+
 void mulBitByOne()
 {
 	BigInt num;
@@ -576,6 +1900,7 @@ int main(int argc, char *argv[])
 
 	runTest(testIsEqual);
 	runTest(testConvertToFromString);
+	runTest(testByteArray);
 	runTest(testSetValues);
 	runTest(testAddition);
 	runTest(testSubtraction);
@@ -585,15 +1910,48 @@ int main(int argc, char *argv[])
 	runTest(testBits);
 	runTest(testGetPosMostSignificatnBit);
 	runTest(testMontgomeryMultiplication);
+	runTest(testMontgomeryMultiplicationCIOS);
+	runTest(testMontgomeryDomain);
+	runTest(testMultiplication);
+	runTest(testKaratsubaThreshold);
+	runTest(testFixedLength<512>);
+	runTest(testFixedLength<2048>);
+	runTest(testFixedLength<3072>);
+	runTest(testFixedLength<4096>);
 	runTest(testMultiplicationByBit);
 	runTest(testModularReduction);
 	runTest(testCopy);
 	runTest(testExp);
+	runTest(testExpWorkspace);
+	runTest(testValueSemantics);
+	runTest(testSlidingWindowExp);
+	runTest(testFixedBaseExp);
+	runTest(testMontgomerySquaring);
+	runTest(testMontKernels52);
+	runTest(testBatch);
+	runTest(testModInverse);
+	runTest(testJacobi);
+	runTest(testRabinLoadKeys);
+	runTest(testRabinNonResidue);
+	runTest(testRabinBadKeys);
+	runTest(testModContext);
 	runTest(testDivision);
+	runTest(testDivisionRandom);
+	runTest(testDivisionByWord);
 	runTest(testGenerator);
+	runTest(testGeneratorSequence);
+	runTest(testGeneratorStreams);
 	runTest(testGcd);
+	runTest(testPrimeSearch);
+	runTest(testParallelBlumPrime);
+	runTest(testThreadPool);
+	runTest(testSignMessages);
+	runTest(testCheckSignatures);
+	runTest(testHashMidstate);
+	runTest(testSignRoundTrip);
 	//runTest(testPrimeGenerator);
 
+	mesureTimeRunning(benchGenerator);
 //	mesureTimeRunning(testPrimeGenerator);
 //	mesureTimeRunning(testPrimeBlumGenerator);
 